@@ -0,0 +1,297 @@
+/***********************************************************************/
+/***********************************************************************
+ Pipeline Cache Simulator -- single pass stack distance analysis
+ ***********************************************************************/
+/***********************************************************************/
+#include "iplc-internal.h"
+
+/************************************************************************************************/
+/* Stack Distance Analysis **********************************************************************/
+/************************************************************************************************/
+
+/*
+ * One LRU stack per block size.  A set-associative cache with 2^k sets maps
+ * two blocks to the same set exactly when their low k block address bits
+ * match, so while walking the stack down to a reused block we bucket every
+ * block above it by how many low bits it shares with the reused one.  The
+ * suffix sums of those buckets are the per-set stack distances for every
+ * index at once, and an access hits in an assoc-way cache iff that distance
+ * is below assoc.
+ */
+#define SD_MAX_INDEX 31
+
+typedef struct stack_distance
+{
+    int           blocksize;
+    int           blockoffsetbits;
+    int           max_index;                        // largest index that fits direct mapped
+    int           max_assoc[SD_MAX_INDEX + 1];      // largest assoc that fits per index
+    unsigned long *hist[SD_MAX_INDEX + 1];          // hist[index][distance], max_assoc = miss
+    
+    // LRU stack as a doubly linked list over a node pool, MRU at head
+    uint32_t      *block;
+    int           *prev;
+    int           *next;
+    int           head;
+    int           nodes;
+    int           capacity;
+    
+    // open addressing map from block address to node + 1 (0 is empty)
+    uint32_t      *map_keys;
+    int           *map_vals;
+    unsigned int  map_size;
+} stack_distance_t;
+
+static unsigned int sd_hash(uint32_t block, unsigned int map_size)
+{
+    return (block * 2654435761U) & (map_size - 1);
+}
+
+static int sd_lookup(stack_distance_t *sd, uint32_t block)
+{
+    unsigned int i = sd_hash(block, sd->map_size);
+    
+    while (sd->map_vals[i]) {
+        if (sd->map_keys[i] == block)
+            return sd->map_vals[i] - 1;
+        i = (i + 1) & (sd->map_size - 1);
+    }
+    return -1;
+}
+
+static void sd_insert(stack_distance_t *sd, uint32_t block, int node)
+{
+    unsigned int i = sd_hash(block, sd->map_size);
+    
+    while (sd->map_vals[i])
+        i = (i + 1) & (sd->map_size - 1);
+    sd->map_keys[i] = block;
+    sd->map_vals[i] = node + 1;
+}
+
+static int sd_new_node(stack_distance_t *sd, uint32_t new_block)
+{
+    unsigned int i, old_size;
+    uint32_t *old_keys, *block;
+    int *old_vals, *prev, *next;
+    
+    if (sd->nodes == sd->capacity) {
+        sd->capacity = sd->capacity ? sd->capacity * 2 : 4096;
+        block = (uint32_t *) realloc(sd->block, sd->capacity * sizeof(uint32_t));
+        if (block)
+            sd->block = block;
+        prev = (int *) realloc(sd->prev, sd->capacity * sizeof(int));
+        if (prev)
+            sd->prev = prev;
+        next = (int *) realloc(sd->next, sd->capacity * sizeof(int));
+        if (next)
+            sd->next = next;
+        if (!block || !prev || !next)
+            return -1;
+    }
+    
+    // keep the map at most half full
+    if (2 * (sd->nodes + 1) > sd->map_size) {
+        old_keys = sd->map_keys;
+        old_vals = sd->map_vals;
+        old_size = sd->map_size;
+        sd->map_size = old_size * 2;
+        sd->map_keys = (uint32_t *) calloc(sd->map_size, sizeof(uint32_t));
+        sd->map_vals = (int *) calloc(sd->map_size, sizeof(int));
+        if (!sd->map_keys || !sd->map_vals) {
+            free(sd->map_keys);
+            free(sd->map_vals);
+            sd->map_keys = old_keys;
+            sd->map_vals = old_vals;
+            sd->map_size = old_size;
+            return -1;
+        }
+        for (i = 0; i < old_size; i++)
+            if (old_vals[i])
+                sd_insert(sd, old_keys[i], old_vals[i] - 1);
+        free(old_keys);
+        free(old_vals);
+    }
+    
+    sd->block[sd->nodes] = new_block;
+    sd_insert(sd, new_block, sd->nodes);
+    return sd->nodes++;
+}
+
+static int sd_init(stack_distance_t *sd, int blocksize)
+{
+    int k;
+    
+    bzero(sd, sizeof(stack_distance_t));
+    sd->blocksize = blocksize;
+    sd->blockoffsetbits = (int) rint((log( (double) (blocksize * 4) )/ log(2)));
+    sd->head = -1;
+    sd->max_index = -1;
+    sd->map_size = 8192;
+    sd->map_keys = (uint32_t *) calloc(sd->map_size, sizeof(uint32_t));
+    sd->map_vals = (int *) calloc(sd->map_size, sizeof(int));
+    
+    for (k = 0; k <= SD_MAX_INDEX && iplc_sim_cache_size(k, blocksize, 1) <= MAX_CACHE_SIZE; k++) {
+        sd->max_index = k;
+        sd->max_assoc[k] = MAX_CACHE_SIZE / iplc_sim_cache_size(k, blocksize, 1);
+        sd->hist[k] = (unsigned long *) calloc(sd->max_assoc[k] + 1, sizeof(unsigned long));
+        if (sd->hist[k] == NULL)
+            return -1;
+    }
+    
+    return (sd->map_keys && sd->map_vals) ? 0 : -1;
+}
+
+static void sd_free(stack_distance_t *sd)
+{
+    int k;
+    
+    for (k = 0; k <= sd->max_index; k++)
+        free(sd->hist[k]);
+    free(sd->block);
+    free(sd->prev);
+    free(sd->next);
+    free(sd->map_keys);
+    free(sd->map_vals);
+}
+
+/*
+ * True once every index has seen at least max_assoc blocks of its set,
+ * i.e. the access misses in every geometry and the walk can stop.
+ */
+static int sd_saturated(stack_distance_t *sd, unsigned long *count)
+{
+    int k;
+    unsigned long distance = 0;
+    
+    for (k = sd->max_index; k >= 0; k--) {
+        distance += count[k];
+        if (distance < sd->max_assoc[k])
+            return 0;
+    }
+    return 1;
+}
+
+static int sd_access(stack_distance_t *sd, unsigned int address)
+{
+    uint32_t block = address >> sd->blockoffsetbits;
+    unsigned long count[SD_MAX_INDEX + 1];
+    unsigned long distance = 0;
+    int node, e, k, depth;
+    
+    node = sd_lookup(sd, block);
+    
+    if (node < 0) {
+        // compulsory miss everywhere
+        for (k = 0; k <= sd->max_index; k++)
+            sd->hist[k][sd->max_assoc[k]]++;
+        node = sd_new_node(sd, block);
+        if (node < 0)
+            return -1;
+    }
+    else {
+        bzero(count, sizeof(count));
+        for (e = sd->head, depth = 1; e != node; e = sd->next[e], depth++) {
+            k = __builtin_ctz(sd->block[e] ^ block);
+            count[k < sd->max_index ? k : sd->max_index]++;
+            if ((depth & 15) == 0 && sd_saturated(sd, count))
+                break;
+        }
+        
+        for (k = sd->max_index; k >= 0; k--) {
+            distance += count[k];
+            sd->hist[k][distance < sd->max_assoc[k] ? distance : sd->max_assoc[k]]++;
+        }
+        
+        if (node == sd->head)
+            return 0;
+        
+        // unlink
+        sd->next[sd->prev[node]] = sd->next[node];
+        if (sd->next[node] >= 0)
+            sd->prev[sd->next[node]] = sd->prev[node];
+    }
+    
+    // push as MRU
+    sd->prev[node] = -1;
+    sd->next[node] = sd->head;
+    if (sd->head >= 0)
+        sd->prev[sd->head] = node;
+    sd->head = node;
+    return 0;
+}
+
+/*
+ * One table of hit/miss counts: every (index, blocksize, assoc) of the
+ * stacks in sd that fits under MAX_CACHE_SIZE.
+ */
+static void sd_print(FILE *out, const char *name, const char *what, stack_distance_t *sd, int num_sizes,
+                     unsigned long accesses)
+{
+    int b, k, a;
+    unsigned long hits;
+    
+    fprintf(out, "%s Stack Distance Analysis (LRU, %lu %s) \n", name, accesses, what);
+    fprintf(out, "%8s %10s %6s %10s %10s %10s %10s \n",
+            "Index", "BlockSize", "Assoc", "CacheSize", "Hits", "Misses", "MissRate");
+    for (b = 0; b < num_sizes; b++) {
+        for (k = 0; k <= sd[b].max_index; k++) {
+            hits = 0;
+            for (a = 1; a <= sd[b].max_assoc[k]; a++) {
+                hits += sd[b].hist[k][a - 1];
+                fprintf(out, "%8d %10d %6d %10lu %10lu %10lu %10f \n",
+                        k, sd[b].blocksize, a, iplc_sim_cache_size(k, sd[b].blocksize, a),
+                        hits, accesses - hits, accesses ? (double)(accesses - hits) / (double)accesses : 0.0);
+            }
+        }
+    }
+}
+
+/*
+ * Walk the trace once and report true-LRU hit/miss counts for every
+ * (index, blocksize, assoc) that fits under MAX_CACHE_SIZE, with one stack
+ * per block size for the I-cache's fetches and one for the D-cache's lw
+ * and sw accesses.  Each L1 only ever sees its own stream in trace order,
+ * so the counts are what a run of that geometry with LRU replacement and
+ * write allocate gets from the L1s.  Returns -1 if memory runs out.
+ */
+int iplc_sim_stack_analysis(const trace_t *trace, FILE *out)
+{
+    const trace_record_t *records = trace->records;
+    stack_distance_t isd[SD_MAX_INDEX + 1], dsd[SD_MAX_INDEX + 1];
+    int num_sizes = 0;
+    int b, error = 0;
+    unsigned long r, data_accesses = 0;
+    
+    for (b = 1; iplc_sim_cache_size(0, b, 1) <= MAX_CACHE_SIZE; b *= 2) {
+        if (sd_init(&isd[num_sizes], b) < 0)
+            error = 1;
+        if (sd_init(&dsd[num_sizes], b) < 0)
+            error = 1;
+        num_sizes++;
+    }
+    
+    for (r = 0; r < trace->count && !error; r++) {
+        for (b = 0; b < num_sizes; b++) {
+            if (sd_access(&isd[b], records[r].instruction_address) < 0)
+                error = 1;
+            if (records[r].opcode == OP_LW || records[r].opcode == OP_SW)
+                if (sd_access(&dsd[b], records[r].data_address) < 0)
+                    error = 1;
+        }
+        data_accesses += records[r].opcode == OP_LW || records[r].opcode == OP_SW;
+    }
+    
+    if (!error) {
+        sd_print(out, "I-Cache", "fetches", isd, num_sizes, trace->count);
+        fprintf(out, "\n");
+        sd_print(out, "D-Cache", "accesses", dsd, num_sizes, data_accesses);
+    }
+    
+    for (b = 0; b < num_sizes; b++) {
+        sd_free(&isd[b]);
+        sd_free(&dsd[b]);
+    }
+    
+    return error ? -1 : 0;
+}
@@ -0,0 +1,260 @@
+/***********************************************************************/
+/***********************************************************************
+ Pipeline Cache Simulator -- tag store and replacement policy benchmark
+ ***********************************************************************/
+/***********************************************************************/
+#include <time.h>
+
+#include "iplc-internal.h"
+
+#define BENCH_REPEATS 20
+#define BENCH_LOOKUPS (1 << 24)     // tag lookups per timed run
+
+/*
+ * Geometries to time, weighted toward the high associativity configurations
+ * where tag matching dominates.
+ */
+static const int bench_configs[][3] = {
+    /* index, blocksize, assoc */
+    {2, 2, 2},
+    {4, 1, 8},
+    {3, 1, 16},
+    {2, 1, 32},
+    {0, 4, 32},
+    {1, 1, 64},
+    {0, 2, 64},
+    {0, 1, 128},
+    {0, 1, 162},
+};
+
+/*
+ * Geometries to compare the replacement policies on.
+ */
+static const int policy_configs[][3] = {
+    /* index, blocksize, assoc */
+    {2, 2, 2},
+    {1, 1, 8},
+    {0, 2, 8},
+    {0, 1, 64},
+};
+
+static double bench_now()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*
+ * Best, median and worst of BENCH_REPEATS timed runs.
+ */
+typedef struct bench_timing
+{
+    double        best;
+    double        median;
+    double        worst;
+} bench_timing_t;
+
+static int bench_compare(const void *a, const void *b)
+{
+    double x = *(const double *) a, y = *(const double *) b;
+
+    return (x > y) - (x < y);
+}
+
+/*
+ * Every access of the trace in order, the fetch and then the data access
+ * of a lw or sw.  Returns NULL if memory runs out.
+ */
+static unsigned int *bench_accesses(const trace_t *trace, unsigned long *count)
+{
+    unsigned int *addresses = (unsigned int *) malloc(2 * trace->count * sizeof(unsigned int));
+    unsigned long r;
+
+    *count = 0;
+    for (r = 0; addresses && r < trace->count; r++) {
+        addresses[(*count)++] = trace->records[r].instruction_address;
+        if (trace->records[r].opcode == OP_LW || trace->records[r].opcode == OP_SW)
+            addresses[(*count)++] = trace->records[r].data_address;
+    }
+    return addresses;
+}
+
+/*
+ * Replay the access stream through cache once to fill it, and note the set
+ * index and tag of every access for bench_find().
+ */
+static void bench_fill(iplc_sim_t *sim, cache_t *cache, const unsigned int *addresses, unsigned long count,
+                       unsigned int *index, uint32_t *tag)
+{
+    unsigned long a;
+
+    for (a = 0; a < count; a++) {
+        iplc_sim_warm_address(sim, cache, addresses[a], 0);
+        index[a] = (addresses[a] >> cache->blockoffsetbits) & cache->set_mask;
+        tag[a] = addresses[a] >> cache->tag_shift;
+    }
+}
+
+/*
+ * Time tag lookups alone: iplc_sim_cache_find() over the set index and tag
+ * of every access, round and round for BENCH_LOOKUPS lookups, with the
+ * cache left as bench_fill() filled it.  Nanoseconds per lookup into
+ * timing, and the hits of one run into *hits.
+ */
+static void bench_find(const cache_t *cache, const unsigned int *index, const uint32_t *tag, unsigned long count,
+                       bench_timing_t *timing, long *hits)
+{
+    double times[BENCH_REPEATS], start;
+    unsigned long a, n;
+    long found = 0;
+    int i;
+
+    for (i = 0; i < BENCH_REPEATS; i++) {
+        found = 0;
+        start = bench_now();
+        for (a = 0, n = 0; a < BENCH_LOOKUPS; a++) {
+            found += iplc_sim_cache_find(cache, index[n], tag[n]) >= 0;
+            if (++n == count)
+                n = 0;
+        }
+        times[i] = (bench_now() - start) * 1e9 / BENCH_LOOKUPS;
+    }
+    qsort(times, BENCH_REPEATS, sizeof(double), bench_compare);
+    timing->best = times[0];
+    timing->median = times[BENCH_REPEATS / 2];
+    timing->worst = times[BENCH_REPEATS - 1];
+    *hits = found;
+}
+
+/*
+ * Best of repeats quiet runs over the whole trace, in seconds.
+ */
+static double bench_run(const trace_t *trace, iplc_sim_config_t *config, iplc_sim_stats_t *stats, int repeats)
+{
+    iplc_sim_t *sim = NULL;
+    double best = 0, start, elapsed;
+    unsigned long r;
+    int i;
+
+    for (i = 0; i < repeats; i++) {
+        start = bench_now();
+        sim = iplc_sim_create(config);
+        if (sim == NULL) {
+            printf("Cannot create %d %d %d \n", config->icache.index, config->icache.blocksize, config->icache.assoc);
+            exit(-1);
+        }
+        for (r = 0; r < trace->count; r++)
+            iplc_sim_step(sim, &trace->records[r]);
+        // padding too, the stats are compared with memcmp()
+        bzero(stats, sizeof(iplc_sim_stats_t));
+        iplc_sim_finalize(sim, stats);
+        iplc_sim_destroy(sim);
+        elapsed = bench_now() - start;
+        if (i == 0 || elapsed < best)
+            best = elapsed;
+    }
+
+    return best;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *trace_file_name = argc > 1 ? argv[1] : "instruction-trace.txt";
+    trace_t trace;
+    iplc_sim_config_t config;
+    iplc_sim_stats_t scalar_stats, simd_stats;
+    iplc_sim_t *sim = NULL;
+    bench_timing_t scalar, simd;
+    unsigned int *addresses = NULL, *index = NULL;
+    uint32_t *tag = NULL;
+    unsigned long count;
+    long scalar_hits, simd_hits;
+    double simd_time;
+    int i, p;
+
+    if (iplc_sim_load_trace(trace_file_name, &trace) < 0)
+        exit(-1);
+    addresses = bench_accesses(&trace, &count);
+    index = (unsigned int *) malloc(count * sizeof(unsigned int));
+    tag = (uint32_t *) malloc(count * sizeof(uint32_t));
+    if (addresses == NULL || index == NULL || tag == NULL) {
+        printf("Out of memory collecting the access stream \n");
+        exit(-1);
+    }
+
+    printf("%d tag lookups replaying the %lu accesses of %s, ns per lookup over %d runs \n",
+           BENCH_LOOKUPS, count, trace_file_name, BENCH_REPEATS);
+    printf("%6s %10s %6s %12s %12s %12s %12s %8s %8s \n", "Index", "BlockSize", "Assoc",
+           "Scalar best", "Scalar med", "SIMD best", "SIMD med", "Speedup", "Spread");
+
+    for (i = 0; i < sizeof(bench_configs) / sizeof(bench_configs[0]); i++) {
+        iplc_sim_config_init(&config);
+        config.icache.index = bench_configs[i][0];
+        config.icache.blocksize = bench_configs[i][1];
+        config.icache.assoc = bench_configs[i][2];
+        config.dcache = config.icache;
+        config.events = 0;
+
+        // whole runs must agree before the lookups are worth timing
+        config.scalar_tag_match = 1;
+        bench_run(&trace, &config, &scalar_stats, 1);
+        config.scalar_tag_match = 0;
+        bench_run(&trace, &config, &simd_stats, 1);
+        if (memcmp(&scalar_stats, &simd_stats, sizeof(iplc_sim_stats_t)) != 0) {
+            printf("Scalar and SIMD results differ for %d %d %d \n",
+                   config.icache.index, config.icache.blocksize, config.icache.assoc);
+            exit(-1);
+        }
+
+        // the same filled cache both ways
+        sim = iplc_sim_create(&config);
+        if (sim == NULL) {
+            printf("Cannot create %d %d %d \n", config.icache.index, config.icache.blocksize, config.icache.assoc);
+            exit(-1);
+        }
+        bench_fill(sim, &sim->icache, addresses, count, index, tag);
+        sim->icache.simd = 0;
+        bench_find(&sim->icache, index, tag, count, &scalar, &scalar_hits);
+        sim->icache.simd = 1;
+        bench_find(&sim->icache, index, tag, count, &simd, &simd_hits);
+        iplc_sim_destroy(sim);
+        if (scalar_hits != simd_hits) {
+            printf("Scalar and SIMD lookups differ for %d %d %d \n",
+                   config.icache.index, config.icache.blocksize, config.icache.assoc);
+            exit(-1);
+        }
+
+        // spread is how far the slowest run of either is above its best
+        printf("%6d %10d %6d %12.2f %12.2f %12.2f %12.2f %8.2f %7.0f%% \n",
+               config.icache.index, config.icache.blocksize, config.icache.assoc,
+               scalar.best, scalar.median, simd.best, simd.median, scalar.best / simd.best,
+               100 * fmax(scalar.worst / scalar.best, simd.worst / simd.best) - 100);
+    }
+
+    printf("\n%6s %10s %6s %8s %10s %12s \n", "Index", "BlockSize", "Assoc", "Policy", "Miss Rate", "ms");
+
+    for (i = 0; i < sizeof(policy_configs) / sizeof(policy_configs[0]); i++) {
+        for (p = 0; p < NUM_POLICIES; p++) {
+            iplc_sim_config_init(&config);
+            config.icache.index = policy_configs[i][0];
+            config.icache.blocksize = policy_configs[i][1];
+            config.icache.assoc = policy_configs[i][2];
+            config.icache.policy = p;
+            config.dcache = config.icache;
+            config.events = 0;
+
+            simd_time = bench_run(&trace, &config, &simd_stats, BENCH_REPEATS);
+            printf("%6d %10d %6d %8s %10.4f %12.3f \n", config.icache.index, config.icache.blocksize, config.icache.assoc,
+                   policy_names[p], (double)simd_stats.cache_miss / (double)simd_stats.cache_access,
+                   simd_time * 1e3);
+        }
+    }
+
+    free(addresses);
+    free(index);
+    free(tag);
+    iplc_sim_free_trace(&trace);
+    return 0;
+}
@@ -0,0 +1,211 @@
+/***********************************************************************/
+/***********************************************************************
+ Pipeline Cache Simulator -- branch prediction
+ ***********************************************************************/
+/***********************************************************************/
+#include "iplc-internal.h"
+
+const char *predictor_names[NUM_PREDICTORS] = {
+    "static", "bimodal", "gshare", "tournament"
+};
+
+/*
+ * Look a predictor up by its name, -1 if there is no such predictor.
+ */
+int iplc_sim_predictor_by_name(const char *name)
+{
+    int i;
+
+    for (i = 0; i < NUM_PREDICTORS; i++)
+        if (strcmp(name, predictor_names[i]) == 0)
+            return i;
+    return -1;
+}
+
+/************************************************************************************************/
+/* Predictor Functions **************************************************************************/
+/************************************************************************************************/
+
+/*
+ * Size the tables for config and carve them out of one allocation.  2-bit
+ * counters start weakly not taken, the chooser weakly favours bimodal.
+ * Returns -1 if memory runs out.
+ */
+int iplc_sim_init_predictor(branch_predictor_t *bp, const iplc_sim_config_t *config)
+{
+    size_t table = 0, chooser = 0, btb = 0, ras = 0;
+    char *block;
+
+    bzero(bp, sizeof(branch_predictor_t));
+    bp->type = config->predictor;
+    bp->predict_taken = config->branch_predict_taken;
+
+    if (bp->type != PREDICTOR_STATIC)
+        table = (size_t) 1 << config->bp_table_bits;
+    if (bp->type == PREDICTOR_TOURNAMENT)
+        chooser = (size_t) 1 << config->bp_chooser_bits;
+    btb = config->btb_entries;
+    ras = config->ras_depth;
+
+    bp->table_mask = table ? table - 1 : 0;
+    bp->chooser_mask = chooser ? chooser - 1 : 0;
+    bp->history_mask = (1U << config->bp_history_bits) - 1;
+    bp->btb_mask = btb ? btb - 1 : 0;
+    bp->btb_entries = btb;
+    bp->ras_depth = ras;
+
+    bp->store_size = btb * 2 * sizeof(uint32_t) + ras * sizeof(uint32_t) + 2 * table + chooser + 1;
+    bp->store = calloc(1, bp->store_size);
+    if (bp->store == NULL)
+        return -1;
+    block = (char *) bp->store;
+    bp->btb_tag = (uint32_t *) block;
+    bp->btb_target = bp->btb_tag + btb;
+    bp->ras = bp->btb_target + btb;
+    block = (char *) (bp->ras + ras);
+    bp->bimodal = (uint8_t *) block;
+    bp->gshare = bp->bimodal + table;
+    bp->chooser = bp->gshare + table;
+
+    memset(bp->bimodal, 1, 2 * table + chooser);
+    return 0;
+}
+
+void iplc_sim_free_predictor(branch_predictor_t *bp)
+{
+    free(bp->store);
+    bzero(bp, sizeof(branch_predictor_t));
+}
+
+static void counter_update(uint8_t *counter, int taken)
+{
+    if (taken && *counter < 3)
+        (*counter)++;
+    else if (!taken && *counter > 0)
+        (*counter)--;
+}
+
+/*
+ * Predict the beq at address, train on what it did, and return which part
+ * of the prediction sent fetch down the wrong path, if any.  A predicted
+ * taken branch also needs the BTB (when there is one) to hold the right
+ * target.  A branch is correct when fetch went down the right path, which
+ * is what the pipeline counts as a correct prediction too.
+ */
+static int predict_branch(branch_predictor_t *bp, unsigned int address, int taken, unsigned int target)
+{
+    unsigned int pc = address >> 2;
+    uint8_t *bimodal = NULL, *gshare = NULL, *chooser = NULL;
+    int predicted, use_gshare = 0, mispredict;
+
+    switch (bp->type) {
+        case PREDICTOR_STATIC:
+            predicted = bp->predict_taken;
+            break;
+        case PREDICTOR_BIMODAL:
+            bimodal = &bp->bimodal[pc & bp->table_mask];
+            predicted = *bimodal >= 2;
+            break;
+        case PREDICTOR_GSHARE:
+            gshare = &bp->gshare[(pc ^ bp->history) & bp->table_mask];
+            predicted = *gshare >= 2;
+            break;
+        default:
+            bimodal = &bp->bimodal[pc & bp->table_mask];
+            gshare = &bp->gshare[(pc ^ bp->history) & bp->table_mask];
+            chooser = &bp->chooser[pc & bp->chooser_mask];
+            use_gshare = *chooser >= 2;
+            predicted = use_gshare ? *gshare >= 2 : *bimodal >= 2;
+            break;
+    }
+
+    if (bimodal && (*bimodal >= 2) == taken)
+        bp->stats.bimodal_correct++;
+    if (gshare && (*gshare >= 2) == taken)
+        bp->stats.gshare_correct++;
+    if (chooser && use_gshare)
+        bp->stats.chooser_gshare++;
+
+    mispredict = predicted == taken ? MISPREDICT_NONE : MISPREDICT_DIRECTION;
+
+    if (bp->btb_entries) {
+        unsigned int slot = pc & bp->btb_mask;
+
+        // with no entry there is no target to go to and fetch falls through
+        if (predicted) {
+            bp->stats.btb_lookups++;
+            if (bp->btb_tag[slot] == (address | 1)) {
+                bp->stats.btb_hits++;
+                if (taken && bp->btb_target[slot] != target)
+                    mispredict = MISPREDICT_BTB;
+            }
+            else
+                mispredict = taken ? MISPREDICT_BTB : MISPREDICT_NONE;
+        }
+        if (taken) {
+            bp->btb_tag[slot] = address | 1;
+            bp->btb_target[slot] = target;
+        }
+    }
+    bp->stats.predictions++;
+    if (mispredict == MISPREDICT_NONE)
+        bp->stats.correct++;
+    else if (mispredict == MISPREDICT_BTB)
+        bp->stats.btb_mispredicts++;
+    else if (mispredict == MISPREDICT_DIRECTION)
+        bp->stats.direction_mispredicts++;
+
+    // train
+    if (chooser && (*bimodal >= 2) != (*gshare >= 2))
+        counter_update(chooser, (*gshare >= 2) == taken);
+    if (bimodal)
+        counter_update(bimodal, taken);
+    if (gshare)
+        counter_update(gshare, taken);
+    bp->history = ((bp->history << 1) | taken) & bp->history_mask;
+
+    return mispredict;
+}
+
+/*
+ * Settle the control instruction at address now that the trace says the
+ * next instruction is at next_address.  jal pushes its return address on the
+ * RAS and jr pops it; j, jal and jr without a RAS are resolved in time as
+ * they always were.  Returns the enum mispredict the pipeline has to pay
+ * for.
+ */
+int iplc_sim_predict(branch_predictor_t *bp, int opcode, unsigned int address, unsigned int next_address)
+{
+    unsigned int predicted;
+
+    switch (opcode) {
+        case OP_BEQ:
+            return predict_branch(bp, address, next_address != address + 4, next_address);
+        case OP_JAL:
+            if (bp->ras_depth) {
+                bp->ras[bp->ras_top] = address + 4;
+                bp->ras_top = (bp->ras_top + 1) % bp->ras_depth;
+                if (bp->ras_count < bp->ras_depth)
+                    bp->ras_count++;
+            }
+            return MISPREDICT_NONE;
+        case OP_JR:
+            if (!bp->ras_depth)
+                return MISPREDICT_NONE;
+            predicted = 0;
+            if (bp->ras_count) {
+                bp->ras_top = (bp->ras_top + bp->ras_depth - 1) % bp->ras_depth;
+                bp->ras_count--;
+                predicted = bp->ras[bp->ras_top];
+            }
+            bp->stats.ras_predictions++;
+            if (predicted == next_address) {
+                bp->stats.ras_correct++;
+                return MISPREDICT_NONE;
+            }
+            bp->stats.ras_mispredicts++;
+            return MISPREDICT_RAS;
+        default:
+            return MISPREDICT_NONE;
+    }
+}
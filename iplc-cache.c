@@ -0,0 +1,823 @@
+/***********************************************************************/
+/***********************************************************************
+ Pipeline Cache Simulator -- cache model
+ ***********************************************************************/
+/***********************************************************************/
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "iplc-internal.h"
+
+const char *inclusion_names[NUM_INCLUSIONS] = {
+    "nine", "inclusive", "exclusive"
+};
+
+const char *write_policy_names[NUM_WRITE_POLICIES] = {
+    "off", "back", "through"
+};
+
+/************************************************************************************************/
+/* Cache Functions ******************************************************************************/
+/************************************************************************************************/
+/*
+ * Size in bits (data, tag and valid bit) of a cache geometry; this is what
+ * is checked against MAX_CACHE_SIZE.
+ */
+unsigned long iplc_sim_cache_size(int index, int blocksize, int assoc)
+{
+    int blockoffsetbits = (int) rint((log( (double) (blocksize * 4) )/ log(2)));
+
+    return assoc * ( 1UL << index ) * ((32 * blocksize) + 33 - index - blockoffsetbits);
+}
+
+/*
+ * Look an inclusion policy up by its name, -1 if there is no such policy.
+ */
+int iplc_sim_inclusion_by_name(const char *name)
+{
+    int i;
+    
+    for (i = 0; i < NUM_INCLUSIONS; i++)
+        if (strcmp(name, inclusion_names[i]) == 0)
+            return i;
+    return -1;
+}
+
+/*
+ * Look a write policy up by its name, -1 if there is no such policy.
+ */
+int iplc_sim_write_policy_by_name(const char *name)
+{
+    int i;
+    
+    for (i = 0; i < NUM_WRITE_POLICIES; i++)
+        if (strcmp(name, write_policy_names[i]) == 0)
+            return i;
+    return -1;
+}
+
+/*
+ * Correctly configure the cache.  Returns -1 if the geometry does not fit
+ * under max_size (0 for no limit), the policy is unknown or memory runs
+ * out.
+ */
+int iplc_sim_init_cache(iplc_sim_t *sim, cache_t *cache, const char *name,
+                        const iplc_cache_config_t *config, unsigned long max_size)
+{
+    const char *c;
+    uint32_t salt = 0;
+    int index = config->index, blocksize = config->blocksize, assoc = config->assoc;
+    int policy = config->policy;
+    unsigned long cache_size = 0;
+    size_t sets, tags_size, valid_size, repl_size;
+    int i=0;
+    
+    bzero(cache, sizeof(cache_t));
+    cache->index = index;
+    cache->blocksize = blocksize;
+    cache->assoc = assoc;
+    cache->name = name;
+    cache->latency = config->latency;
+    cache->inclusion = config->inclusion;
+    
+    
+    cache->blockoffsetbits =
+    (int) rint((log( (double) (blocksize * 4) )/ log(2)));
+    /* Note: rint function rounds the result up prior to casting */
+    
+    cache_size = iplc_sim_cache_size(index, blocksize, assoc);
+    
+    if (EVENT_ON(sim, EVENT_CONFIG))
+        iplc_sim_event(sim, EVENT_TYPE_CONFIG,
+                       cache == &sim->icache ? 0 : cache == &sim->dcache ? 1 : cache == &sim->l2 ? 2 : 3,
+                       cache->inclusion << 8 | (policy >= 0 && policy < NUM_POLICIES ? policy : 0xff),
+                       (uint32_t) (index & 0xff) << 24 | (cache->blockoffsetbits & 0xff) << 16 | (assoc & 0xffff),
+                       (uint32_t) blocksize, (uint32_t) cache->latency);
+    
+    // policy state indexes ways with bytes
+    if ((max_size && cache_size > max_size) || assoc < 1 || assoc > 255 ||
+        policy < 0 || policy >= NUM_POLICIES)
+        return -1;
+    
+    cache->set_mask = (1U << index) - 1;
+    cache->tag_shift = cache->blockoffsetbits + index;
+    cache->ways = (assoc + CACHE_TAG_LANES - 1) / CACHE_TAG_LANES * CACHE_TAG_LANES;
+    cache->valid_words = (cache->ways + 63) / 64;
+    cache->simd = !sim->config.scalar_tag_match;
+    
+    cache->policy = &cache_policies[policy];
+    // every cache draws a different random stream from the same seed
+    for (c = name; *c; c++)
+        salt = salt * 31 + *c;
+    cache->rng = (sim->config.seed ? sim->config.seed : 1) ^ (salt * 0x9e3779b9);
+    if (cache->rng == 0)
+        cache->rng = 1;
+    for (cache->plru_leaves = 1; cache->plru_leaves < assoc; cache->plru_leaves <<= 1)
+        cache->plru_levels++;
+    for (i = 0; i < assoc; i++)
+        cache->way_mask[i >> 6] |= 1ULL << (i & 63);
+    cache->repl_stride = (cache->policy->state_size(cache) + 7) & ~(size_t) 7;
+    
+    // one allocation for the whole tag store, every array 64 byte aligned
+    sets = (size_t) 1 << index;
+    tags_size = (sets * cache->ways * sizeof(uint32_t) + 63) & ~(size_t) 63;
+    valid_size = (sets * cache->valid_words * sizeof(uint64_t) + 63) & ~(size_t) 63;
+    repl_size = (sets * cache->repl_stride + 63) & ~(size_t) 63;
+    cache->store_size = tags_size + 3 * valid_size + repl_size;
+    if (posix_memalign(&cache->store, 64, cache->store_size) != 0) {
+        cache->store = NULL;
+        return -1;
+    }
+    bzero(cache->store, cache->store_size);
+    cache->tags = (uint32_t *) cache->store;
+    cache->valid = (uint64_t *) ((char *) cache->store + tags_size);
+    cache->dirty = (uint64_t *) ((char *) cache->store + tags_size + valid_size);
+    cache->prefetched = (uint64_t *) ((char *) cache->store + tags_size + 2 * valid_size);
+    cache->repl = (uint8_t *) ((char *) cache->store + tags_size + 3 * valid_size);
+    
+    for (i = 0; i < sets; i++)
+        cache->policy->init(cache, &cache->repl[i * cache->repl_stride]);
+    
+    if (sim->config.classify_misses) {
+        cache->classifier = (classifier_t *) malloc(sizeof(classifier_t));
+        if (cache->classifier == NULL || iplc_sim_init_classifier(cache->classifier, (int) sets * assoc) < 0)
+            return -1;
+    }
+    
+    return 0;
+}
+
+/*
+ * Release a cache set up by iplc_sim_init_cache().
+ */
+void iplc_sim_free_cache(cache_t *cache)
+{
+    if (cache->classifier)
+        iplc_sim_free_classifier(cache->classifier);
+    free(cache->classifier);
+    free(cache->store);
+    bzero(cache, sizeof(cache_t));
+}
+
+/*
+ * Return the valid way of set index holding tag, or -1.  The vector paths
+ * compare CACHE_TAG_LANES (or 4) ways per instruction and mask the result
+ * with the valid bits, so the first matching way wins just like the scalar
+ * scan.
+ */
+int iplc_sim_cache_find(const cache_t *cache, unsigned int index, uint32_t tag)
+{
+    const uint32_t *tags = &cache->tags[(size_t) index * cache->ways];
+    const uint64_t *valid = &cache->valid[(size_t) index * cache->valid_words];
+    unsigned int mask;
+    int i;
+    
+    if (cache->simd) {
+#if defined(__AVX2__)
+        __m256i key = _mm256_set1_epi32(tag);
+        
+        for (i = 0; i < cache->ways; i += 8) {
+            mask = _mm256_movemask_ps(_mm256_castsi256_ps(
+                       _mm256_cmpeq_epi32(_mm256_load_si256((const __m256i *) &tags[i]), key)));
+            mask &= (valid[i >> 6] >> (i & 63)) & 0xff;
+            if (mask)
+                return i + __builtin_ctz(mask);
+        }
+        return -1;
+#elif defined(__SSE2__)
+        __m128i key = _mm_set1_epi32(tag);
+        
+        for (i = 0; i < cache->ways; i += 4) {
+            mask = _mm_movemask_ps(_mm_castsi128_ps(
+                       _mm_cmpeq_epi32(_mm_load_si128((const __m128i *) &tags[i]), key)));
+            mask &= (valid[i >> 6] >> (i & 63)) & 0xf;
+            if (mask)
+                return i + __builtin_ctz(mask);
+        }
+        return -1;
+#endif
+    }
+    
+    for (i = 0; i < cache->assoc; i++)
+        if (tags[i] == tag && (valid[i >> 6] >> (i & 63)) & 1)
+            return i;
+    return -1;
+}
+
+/*
+ * Put tag in the first invalid way of set index, or failing that in the way
+ * the replacement policy picks.  Returns the enum fill_result flags and
+ * the evicted tag if a valid block had to go, 0 otherwise.  The new block
+ * starts clean and not prefetched.
+ */
+int iplc_sim_replace_on_miss(cache_t *cache, unsigned int index, uint32_t tag, uint32_t *victim_tag)
+{
+    uint32_t *tags = &cache->tags[(size_t) index * cache->ways];
+    uint64_t *valid = &cache->valid[(size_t) index * cache->valid_words];
+    uint64_t *dirty = &cache->dirty[(size_t) index * cache->valid_words];
+    uint64_t *prefetched = &cache->prefetched[(size_t) index * cache->valid_words];
+    uint8_t *state = &cache->repl[(size_t) index * cache->repl_stride];
+    uint64_t invalid;
+    int i=-1, w=0, evicted=0;
+    
+    for (w = 0; w < cache->valid_words; w++) {
+        invalid = ~valid[w] & cache->way_mask[w];
+        if (invalid) {
+            i = w * 64 + __builtin_ctzll(invalid);
+            break;
+        }
+    }
+    if (i < 0) {
+        i = cache->policy->victim(cache, state);
+        *victim_tag = tags[i];
+        evicted = FILL_EVICTED;
+        if ((dirty[i >> 6] >> (i & 63)) & 1)
+            evicted |= FILL_DIRTY;
+        if ((prefetched[i >> 6] >> (i & 63)) & 1)
+            evicted |= FILL_PREFETCHED;
+    }
+    
+    tags[i] = tag;
+    valid[i >> 6] |= 1ULL << (i & 63);
+    dirty[i >> 6] &= ~(1ULL << (i & 63));
+    prefetched[i >> 6] &= ~(1ULL << (i & 63));
+    cache->policy->fill(cache, state, i);
+    
+    return evicted;
+}
+
+
+/*
+ * iplc_sim_cache_lookup() found the entry in our cache.  Update its
+ * information in the cache.
+ */
+void iplc_sim_update_on_hit(cache_t *cache, unsigned int index, int way)
+{
+    cache->policy->hit(cache, &cache->repl[(size_t) index * cache->repl_stride], way);
+}
+
+/*
+ * Look address up in one cache and count the access, and classify it if
+ * misses are being classified.  Returns 1 for a hit, 0 for a miss; a miss
+ * does not fill.
+ */
+int iplc_sim_cache_lookup(cache_t *cache, unsigned int address)
+{
+    unsigned int index = (address >> cache->blockoffsetbits) & cache->set_mask;
+    int way;
+    
+    cache->access++;
+    way = iplc_sim_cache_find(cache, index, address >> cache->tag_shift);
+    if (cache->classifier)
+        iplc_sim_classify(cache->classifier, address >> cache->blockoffsetbits, way >= 0);
+    if (way >= 0) {
+        iplc_sim_update_on_hit(cache, index, way);
+        cache->hit++;
+        return 1;
+    }
+    cache->miss++;
+    return 0;
+}
+
+/*
+ * Bring the block holding address into one cache.  Returns the enum
+ * fill_result flags and the address of the evicted block in victim if a
+ * valid block had to go, 0 otherwise.
+ */
+int iplc_sim_cache_fill(cache_t *cache, unsigned int address, unsigned int *victim)
+{
+    unsigned int index = (address >> cache->blockoffsetbits) & cache->set_mask;
+    uint32_t victim_tag;
+    int evicted;
+    
+    evicted = iplc_sim_replace_on_miss(cache, index, address >> cache->tag_shift, &victim_tag);
+    if (evicted)
+        *victim = (victim_tag << cache->tag_shift) | (index << cache->blockoffsetbits);
+    return evicted;
+}
+
+/*
+ * Drop the block holding address from one cache, if it is there.  Returns
+ * 1 if it was dirty.
+ */
+int iplc_sim_cache_invalidate(cache_t *cache, unsigned int address)
+{
+    unsigned int index = (address >> cache->blockoffsetbits) & cache->set_mask;
+    size_t word;
+    uint64_t bit;
+    int way, dirty;
+    
+    way = iplc_sim_cache_find(cache, index, address >> cache->tag_shift);
+    if (way < 0)
+        return 0;
+    word = (size_t) index * cache->valid_words + (way >> 6);
+    bit = 1ULL << (way & 63);
+    dirty = (cache->dirty[word] & bit) != 0;
+    cache->valid[word] &= ~bit;
+    cache->dirty[word] &= ~bit;
+    cache->prefetched[word] &= ~bit;
+    return dirty;
+}
+
+/*
+ * Set the bit for the block holding address in one of a cache's bitmasks
+ * (dirty or prefetched), if the block is there.  Returns what the bit was.
+ */
+static int iplc_sim_cache_mark(cache_t *cache, uint64_t *bits, unsigned int address, int set)
+{
+    unsigned int index = (address >> cache->blockoffsetbits) & cache->set_mask;
+    size_t word;
+    uint64_t bit;
+    int way, was;
+    
+    way = iplc_sim_cache_find(cache, index, address >> cache->tag_shift);
+    if (way < 0)
+        return 0;
+    word = (size_t) index * cache->valid_words + (way >> 6);
+    bit = 1ULL << (way & 63);
+    was = (bits[word] & bit) != 0;
+    if (set)
+        bits[word] |= bit;
+    else
+        bits[word] &= ~bit;
+    return was;
+}
+
+/*
+ * Mark the block holding address dirty, if it is there.
+ */
+void iplc_sim_cache_mark_dirty(cache_t *cache, unsigned int address)
+{
+    iplc_sim_cache_mark(cache, cache->dirty, address, 1);
+}
+
+/************************************************************************************************/
+/* Write Functions ******************************************************************************/
+/************************************************************************************************/
+
+/*
+ * Cycles the level right below the D-cache takes for a write.
+ */
+static unsigned int iplc_sim_write_latency(const iplc_sim_t *sim)
+{
+    return sim->num_lower ? (unsigned int) sim->lower[0]->latency : (unsigned int) sim->memory_latency;
+}
+
+/*
+ * Hand one write of cost cycles to the write buffer.  A write to a block
+ * already waiting there merges into its entry; anything else drains after
+ * everything before it, one write at a time.  Returns how long the
+ * pipeline has to wait for a free entry, 0 unless they are all taken.
+ */
+static unsigned int iplc_sim_buffer_write(iplc_sim_t *sim, unsigned int block, unsigned int cost)
+{
+    long now = sim->pipeline_cycles;
+    unsigned int wait = 0;
+    int i, slot = -1, first = 0;
+    
+    for (i = 0; i < sim->write_buffer; i++) {
+        if (sim->write_entry[i].done > now && sim->write_entry[i].block == block) {
+            sim->write_stats.coalesced++;
+            return 0;
+        }
+    }
+    
+    for (i = 0; i < sim->write_buffer && slot < 0; i++) {
+        if (sim->write_entry[i].done <= now)
+            slot = i;
+        else if (sim->write_entry[i].done < sim->write_entry[first].done)
+            first = i;
+    }
+    if (slot < 0) {
+        wait = (unsigned int) (sim->write_entry[first].done - now);
+        sim->write_stats.buffer_full_cycles += wait;
+        now += wait;
+        slot = first;
+    }
+    
+    if (sim->write_busy_until < now)
+        sim->write_busy_until = now;
+    sim->write_busy_until += cost;
+    sim->write_entry[slot].block = block;
+    sim->write_entry[slot].done = sim->write_busy_until;
+    return wait;
+}
+
+/*
+ * A dirty block at address left the D-cache.  It goes to the write buffer,
+ * or without one holds the pipeline while the next level takes it.
+ */
+static void iplc_sim_write_back(iplc_sim_t *sim, unsigned int address)
+{
+    unsigned int wait;
+    
+    sim->write_stats.writebacks++;
+    sim->write_stats.writes++;
+    sim->write_stats.bytes += sim->dcache.blocksize * 4;
+    if (sim->write_buffer)
+        wait = iplc_sim_buffer_write(sim, address >> sim->dcache.blockoffsetbits, iplc_sim_write_latency(sim));
+    else
+        wait = iplc_sim_write_latency(sim);
+    sim->pipeline_cycles += wait;
+    sim->write_stats.writeback_cycles += wait;
+}
+
+/************************************************************************************************/
+/* Hierarchy Functions **************************************************************************/
+/************************************************************************************************/
+
+/*
+ * Invalidate every copy of the block at address (block_bytes long) in the
+ * caches above lower level k, to keep an inclusive level inclusive.  Dirty
+ * copies are written back first.
+ */
+static void iplc_sim_back_invalidate(iplc_sim_t *sim, int k, unsigned int address, unsigned int block_bytes)
+{
+    cache_t *upper[MAX_CACHE_LEVELS];
+    unsigned int a;
+    int n = 0, u;
+    
+    upper[n++] = &sim->icache;
+    upper[n++] = &sim->dcache;
+    for (u = 0; u < k; u++)
+        upper[n++] = sim->lower[u];
+    
+    for (u = 0; u < n; u++)
+        for (a = address; a < address + block_bytes; a += upper[u]->blocksize * 4)
+            if (iplc_sim_cache_invalidate(upper[u], a))
+                iplc_sim_write_back(sim, a);
+}
+
+/*
+ * Fill lower level k with the block at address.  Whatever that evicts is
+ * invalidated above if k is inclusive and moves on down if the next level
+ * is exclusive.
+ */
+static void iplc_sim_fill_level(iplc_sim_t *sim, int k, unsigned int address)
+{
+    cache_t *cache = sim->lower[k];
+    unsigned int victim;
+    
+    if (!iplc_sim_cache_fill(cache, address, &victim))
+        return;
+    
+    if (cache->inclusion == INCLUSION_INCLUSIVE)
+        iplc_sim_back_invalidate(sim, k, victim, cache->blocksize * 4);
+    if (k + 1 < sim->num_lower && sim->lower[k + 1]->inclusion == INCLUSION_EXCLUSIVE)
+        iplc_sim_fill_level(sim, k + 1, victim);
+}
+
+/*
+ * Walk down the L2 and L3 to memory for the block at address, fill on the
+ * way back up according to each level's inclusion policy, and return the
+ * cycles of the level that served it.  The L1 above is up to the caller.
+ * Only demand accesses show up as events.
+ */
+static unsigned int iplc_sim_fetch_below(iplc_sim_t *sim, unsigned int address, int demand)
+{
+    unsigned int latency;
+    int k, served;
+    
+    for (served = 0; served < sim->num_lower; served++) {
+        if (iplc_sim_cache_lookup(sim->lower[served], address))
+            break;
+    }
+    if (demand && EVENT_ON(sim, EVENT_LOWER))
+        for (k = 0; k < sim->num_lower && k <= served; k++)
+            iplc_sim_event(sim, EVENT_TYPE_LOWER, k == served, 0, address, k + 2, 0);
+    
+    if (served == sim->num_lower) {
+        sim->memory_access++;
+        latency = sim->memory_latency;
+    }
+    else {
+        latency = sim->lower[served]->latency;
+        // the block moves up out of an exclusive level
+        if (sim->lower[served]->inclusion == INCLUSION_EXCLUSIVE)
+            iplc_sim_cache_invalidate(sim->lower[served], address);
+    }
+    
+    for (k = served - 1; k >= 0; k--)
+        if (sim->lower[k]->inclusion != INCLUSION_EXCLUSIVE)
+            iplc_sim_fill_level(sim, k, address);
+    
+    return latency;
+}
+
+/*
+ * Fill an L1 with the block at address.  A dirty victim is written back,
+ * a prefetched one nobody used is counted, and with an exclusive L2 the
+ * victim moves down.  Returns what iplc_sim_cache_fill() does.
+ */
+static int iplc_sim_fill_l1(iplc_sim_t *sim, cache_t *cache, unsigned int address, unsigned int *victim)
+{
+    int evicted;
+    
+    evicted = iplc_sim_cache_fill(cache, address, victim);
+    if (evicted & FILL_DIRTY)
+        iplc_sim_write_back(sim, *victim);
+    if (evicted & FILL_PREFETCHED)
+        cache->prefetcher->stats.unused++;
+    if (evicted && sim->num_lower > 0 && sim->lower[0]->inclusion == INCLUSION_EXCLUSIVE)
+        iplc_sim_fill_level(sim, 0, *victim);
+    return evicted;
+}
+
+/************************************************************************************************/
+/* Prefetch Functions ***************************************************************************/
+/************************************************************************************************/
+
+/*
+ * Move every prefetch of cache that has arrived by now out of the queue
+ * and into the cache, marked as prefetched.  Whatever a prefetch evicts
+ * goes in the pollution filter.
+ */
+static void iplc_sim_prefetch_arrive(iplc_sim_t *sim, cache_t *cache)
+{
+    prefetcher_t *pf = cache->prefetcher;
+    unsigned int address, victim, block;
+    int i;
+    
+    for (i = 0; i < PREFETCH_QUEUE; i++) {
+        if (pf->queue[i].ready == 0 || pf->queue[i].ready > sim->pipeline_cycles)
+            continue;
+        block = pf->queue[i].block;
+        address = block << cache->blockoffsetbits;
+        pf->queue[i].ready = 0;
+        if (pf->filter[block & (PREFETCH_FILTER - 1)] == block + 1)
+            pf->filter[block & (PREFETCH_FILTER - 1)] = 0;
+        if (iplc_sim_cache_find(cache, block & cache->set_mask, address >> cache->tag_shift) >= 0)
+            continue;
+        if (iplc_sim_fill_l1(sim, cache, address, &victim) & FILL_EVICTED) {
+            block = victim >> cache->blockoffsetbits;
+            pf->filter[block & (PREFETCH_FILTER - 1)] = block + 1;
+        }
+        iplc_sim_cache_mark(cache, cache->prefetched, address, 1);
+    }
+}
+
+/*
+ * A demand miss in cache.  If a prefetch for the block is still on its way
+ * the access takes it and only waits for the rest of its latency: set
+ * latency and return 1.  Otherwise see if a prefetch evicted the block.
+ */
+static int iplc_sim_prefetch_late(iplc_sim_t *sim, cache_t *cache, unsigned int address, unsigned int *latency)
+{
+    prefetcher_t *pf = cache->prefetcher;
+    unsigned int block = address >> cache->blockoffsetbits, wait;
+    int i;
+    
+    for (i = 0; i < PREFETCH_QUEUE; i++) {
+        if (pf->queue[i].ready && pf->queue[i].block == block) {
+            wait = (unsigned int) (pf->queue[i].ready - sim->pipeline_cycles);
+            *latency = wait > (unsigned int) cache->latency ? wait : (unsigned int) cache->latency;
+            pf->queue[i].ready = 0;
+            pf->stats.useful++;
+            pf->stats.late++;
+            return 1;
+        }
+    }
+    if (pf->filter[block & (PREFETCH_FILTER - 1)] == block + 1) {
+        pf->filter[block & (PREFETCH_FILTER - 1)] = 0;
+        pf->stats.pollution++;
+    }
+    return 0;
+}
+
+/*
+ * Train cache's prefetcher on a demand access and queue what it asks for.
+ * Blocks already in the cache or the queue are skipped and a full queue
+ * drops the rest.  One prefetch goes out per cycle, each taking as long
+ * as the level below that serves it.
+ */
+static void iplc_sim_prefetch(iplc_sim_t *sim, cache_t *cache, unsigned int pc, unsigned int address,
+                              int outcome)
+{
+    prefetcher_t *pf = cache->prefetcher;
+    unsigned int addresses[MAX_PREFETCH_DEGREE], block;
+    long issue;
+    int n, i, k, slot, queued;
+    
+    n = pf->policy->train(pf, pc, address, outcome, addresses);
+    for (i = 0; i < n; i++) {
+        block = addresses[i] >> cache->blockoffsetbits;
+        if (iplc_sim_cache_find(cache, block & cache->set_mask, addresses[i] >> cache->tag_shift) >= 0)
+            continue;
+        slot = -1;
+        queued = 0;
+        for (k = 0; k < PREFETCH_QUEUE && !queued; k++) {
+            if (pf->queue[k].ready == 0) {
+                if (slot < 0)
+                    slot = k;
+            }
+            else if (pf->queue[k].block == block)
+                queued = 1;
+        }
+        if (queued)
+            continue;
+        if (slot < 0) {
+            pf->stats.dropped++;
+            continue;
+        }
+        
+        issue = pf->next_issue > sim->pipeline_cycles ? pf->next_issue : sim->pipeline_cycles;
+        pf->next_issue = issue + 1;
+        pf->queue[slot].block = block;
+        pf->queue[slot].ready = issue + iplc_sim_fetch_below(sim, block << cache->blockoffsetbits, 0);
+        pf->stats.issued++;
+    }
+}
+
+/*
+ * A demand hit in cache: count the first use of a prefetched block and
+ * train the prefetcher.
+ */
+static void iplc_sim_prefetch_hit(iplc_sim_t *sim, cache_t *cache, unsigned int pc, unsigned int address)
+{
+    int outcome = PREFETCH_HIT;
+    
+    if (iplc_sim_cache_mark(cache, cache->prefetched, address, 0)) {
+        cache->prefetcher->stats.useful++;
+        outcome = PREFETCH_FIRST_USE;
+    }
+    iplc_sim_prefetch(sim, cache, pc, address, outcome);
+}
+
+/************************************************************************************************/
+/* Access Functions *****************************************************************************/
+/************************************************************************************************/
+
+/*
+ * Check if the address is in our L1 cache.  Update our counter statistics 
+ * for cache_access, cache_hit, etc.  On a miss walk down the L2 and L3 to
+ * memory, fill on the way back up according to each level's inclusion
+ * policy, and set latency to the cycles of the level that served the
+ * block.  A dirty victim is written back.  With a prefetcher a miss on a
+ * block still being prefetched waits for the prefetch instead, and the
+ * prefetcher is trained with pc.  Returns 1 for an L1 hit, 0 for a miss.
+ */
+int iplc_sim_trap_address(iplc_sim_t *sim, cache_t *cache, unsigned int pc, unsigned int address,
+                          unsigned int *latency)
+{
+    prefetcher_t *pf = cache->prefetcher;
+    unsigned int victim;
+    
+    //print out current index, address and tag on each instruction..
+    if (EVENT_ON(sim, EVENT_ADDRESS))
+        iplc_sim_event(sim, EVENT_TYPE_ADDRESS, 0, 0, address, address >> cache->tag_shift,
+                       (address >> cache->blockoffsetbits) & cache->set_mask);
+    
+    if (pf)
+        iplc_sim_prefetch_arrive(sim, cache);
+    
+    if (iplc_sim_cache_lookup(cache, address)) {
+        *latency = cache->latency;
+        if (pf)
+            iplc_sim_prefetch_hit(sim, cache, pc, address);
+        return 1;
+    }
+    
+    if (pf == NULL || !iplc_sim_prefetch_late(sim, cache, address, latency))
+        *latency = iplc_sim_fetch_below(sim, address, 1);
+    iplc_sim_fill_l1(sim, cache, address, &victim);
+    if (pf)
+        iplc_sim_prefetch(sim, cache, pc, address, PREFETCH_MISS);
+    
+    return 0;
+}
+
+/*
+ * Send a sw to the D-cache under the write policy.  A miss only fills with
+ * write-allocate, write-back marks the block dirty, and write-through or a
+ * miss that does not allocate also writes the word to the next level.
+ * With a write buffer anything slower than a hit is left to the buffer.
+ * Sets latency to what the pipeline has to wait for, and returns 1 for an
+ * L1 hit, 0 for a miss.
+ */
+int iplc_sim_trap_store(iplc_sim_t *sim, unsigned int pc, unsigned int address, unsigned int *latency)
+{
+    cache_t *cache = &sim->dcache;
+    unsigned int wait;
+    int hit, writes = sim->write_policy == WRITE_THROUGH;
+    
+    sim->write_stats.stores++;
+    if (sim->write_policy == WRITE_OFF || sim->write_allocate)
+        hit = iplc_sim_trap_address(sim, cache, pc, address, latency);
+    else {
+        if (EVENT_ON(sim, EVENT_ADDRESS))
+            iplc_sim_event(sim, EVENT_TYPE_ADDRESS, 0, 0, address, address >> cache->tag_shift,
+                           (address >> cache->blockoffsetbits) & cache->set_mask);
+        if (cache->prefetcher)
+            iplc_sim_prefetch_arrive(sim, cache);
+        hit = iplc_sim_cache_lookup(cache, address);
+        *latency = cache->latency;
+        writes |= !hit;
+        if (cache->prefetcher && hit)
+            iplc_sim_prefetch_hit(sim, cache, pc, address);
+        else if (cache->prefetcher)
+            iplc_sim_prefetch(sim, cache, pc, address, PREFETCH_MISS);
+    }
+    if (!hit)
+        sim->write_stats.store_misses++;
+    if (sim->write_policy == WRITE_OFF)
+        return hit;
+    
+    if (sim->write_policy == WRITE_BACK && (hit || sim->write_allocate))
+        iplc_sim_cache_mark_dirty(cache, address);
+    if (writes) {
+        sim->write_stats.writes++;
+        sim->write_stats.bytes += 4;
+        if (*latency < iplc_sim_write_latency(sim))
+            *latency = iplc_sim_write_latency(sim);
+    }
+    
+    if (sim->write_buffer && *latency > (unsigned int) cache->latency) {
+        wait = iplc_sim_buffer_write(sim, address >> cache->blockoffsetbits, *latency);
+        sim->pipeline_cycles += wait;
+        sim->write_stats.store_cycles += wait;
+        *latency = cache->latency;
+    }
+    return hit;
+}
+
+/*
+ * Functional access for fast-forwarding: the cache, the levels below it
+ * and the dirty bits end up as iplc_sim_trap_address() or
+ * iplc_sim_trap_store() would leave them, and the hit/miss counts go on,
+ * but nothing is timed, no prefetcher is trained and no events go out.
+ */
+void iplc_sim_warm_address(iplc_sim_t *sim, cache_t *cache, unsigned int address, int store)
+{
+    unsigned int victim;
+    int dirty = store && sim->write_policy == WRITE_BACK;
+    
+    if (iplc_sim_cache_lookup(cache, address)) {
+        if (dirty)
+            iplc_sim_cache_mark_dirty(cache, address);
+        return;
+    }
+    if (store && sim->write_policy != WRITE_OFF && !sim->write_allocate)
+        return;
+    
+    iplc_sim_fetch_below(sim, address, 0);
+    if (iplc_sim_cache_fill(cache, address, &victim) && sim->num_lower > 0 &&
+        sim->lower[0]->inclusion == INCLUSION_EXCLUSIVE)
+        iplc_sim_fill_level(sim, 0, victim);
+    if (dirty)
+        iplc_sim_cache_mark_dirty(cache, address);
+}
+
+/************************************************************************************************/
+/* MSHR Functions *******************************************************************************/
+/************************************************************************************************/
+
+/*
+ * Non-blocking D-cache timing for an access iplc_sim_trap_address() just
+ * looked up.  A block already in flight merges into its MSHR, a hit is
+ * ready after the hit latency, and a primary miss takes a free MSHR, the
+ * pipeline stalling here only when there is none.  Returns the cycle the
+ * data is there.
+ */
+long iplc_sim_mshr_access(iplc_sim_t *sim, unsigned int address, int hit, unsigned int latency)
+{
+    unsigned int block = address >> sim->dcache.blockoffsetbits;
+    long now = sim->pipeline_cycles, ready, start, wait;
+    int i, slot = -1, first = 0;
+    
+    for (i = 0; i < sim->num_mshrs; i++) {
+        if (sim->mshr[i].ready > now && sim->mshr[i].block == block) {
+            sim->mshr_stats.secondary_misses++;
+            return sim->mshr[i].ready;
+        }
+    }
+    if (hit)
+        return now + latency;
+    
+    for (i = 0; i < sim->num_mshrs && slot < 0; i++) {
+        if (sim->mshr[i].ready <= now)
+            slot = i;
+        else if (sim->mshr[i].ready < sim->mshr[first].ready)
+            first = i;
+    }
+    if (slot < 0) {
+        wait = sim->mshr[first].ready - now;
+        sim->pipeline_cycles += wait;
+        sim->mshr_stats.full_cycles += wait;
+        now += wait;
+        slot = first;
+    }
+    
+    ready = now + latency;
+    sim->mshr[slot].block = block;
+    sim->mshr[slot].ready = ready;
+    sim->mshr_stats.primary_misses++;
+    sim->mshr_stats.miss_cycles += latency - 1;
+    sim->mshr_stats.busy_cycles += latency;
+    start = sim->mshr_busy_until > now ? sim->mshr_busy_until : now;
+    if (ready > start) {
+        sim->mshr_stats.active_cycles += ready - start;
+        sim->mshr_busy_until = ready;
+    }
+    return ready;
+}
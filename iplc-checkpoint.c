@@ -0,0 +1,375 @@
+/***********************************************************************/
+/***********************************************************************
+ Pipeline Cache Simulator -- checkpoints
+ ***********************************************************************/
+/***********************************************************************/
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "iplc-internal.h"
+
+/************************************************************************************************/
+/* Checkpoint Files *****************************************************************************/
+/************************************************************************************************/
+
+/*
+ * A checkpoint being written to out, or read out of a mapping from at on.
+ */
+typedef struct checkpoint
+{
+    FILE          *out;             // NULL while reading
+    const char    *at;
+    const char    *end;
+} checkpoint_t;
+
+/*
+ * One blob: its size as a uint64_t, then its bytes padded to 8.  Reading
+ * copies it over data, which must be exactly size bytes.  Returns -1 on a
+ * write error or a blob of another size.
+ */
+static int checkpoint_blob(checkpoint_t *ck, void *data, size_t size)
+{
+    static const char padding[8] = {0};
+    size_t padded = (size + 7) & ~(size_t) 7;
+    uint64_t stored = size;
+
+    if (ck->out)
+        return fwrite(&stored, sizeof(stored), 1, ck->out) != 1 ||
+               (size && fwrite(data, 1, size, ck->out) != size) ||
+               fwrite(padding, 1, padded - size, ck->out) != padded - size ? -1 : 0;
+
+    if ((size_t) (ck->end - ck->at) < sizeof(stored) + padded)
+        return -1;
+    memcpy(&stored, ck->at, sizeof(stored));
+    if (stored != size)
+        return -1;
+    memcpy(data, ck->at + sizeof(stored), size);
+    ck->at += sizeof(stored) + padded;
+    return 0;
+}
+
+/*
+ * Reading over a table that grows, size it first for the count entries of
+ * size bytes the checkpoint holds.  Returns -1 if memory runs out.
+ */
+static int checkpoint_resize(checkpoint_t *ck, void **table, size_t count, size_t size)
+{
+    void *grown;
+
+    if (ck->out)
+        return 0;
+    grown = realloc(*table, count * size);
+    if (grown == NULL)
+        return -1;
+    *table = grown;
+    return 0;
+}
+
+/*
+ * The classifier is its own allocation: the struct, then its arrays.
+ */
+static int checkpoint_classifier(checkpoint_t *ck, classifier_t *c)
+{
+    classifier_t fresh = *c;
+
+    if (checkpoint_blob(ck, c, sizeof(classifier_t)) < 0)
+        return -1;
+    if (!ck->out) {
+        c->block = fresh.block;
+        c->prev = fresh.prev;
+        c->next = fresh.next;
+        c->map_keys = fresh.map_keys;
+        c->map_vals = fresh.map_vals;
+        c->seen = fresh.seen;
+        if (c->blocks != fresh.blocks || c->map_mask != fresh.map_mask)
+            return -1;
+        if (checkpoint_resize(ck, (void **) &c->seen, c->seen_mask + 1, sizeof(uint32_t)) < 0)
+            return -1;
+    }
+    if (checkpoint_blob(ck, c->block, c->blocks * sizeof(uint32_t)) < 0 ||
+        checkpoint_blob(ck, c->prev, c->blocks * sizeof(int)) < 0 ||
+        checkpoint_blob(ck, c->next, c->blocks * sizeof(int)) < 0 ||
+        checkpoint_blob(ck, c->map_keys, (c->map_mask + 1) * sizeof(uint32_t)) < 0 ||
+        checkpoint_blob(ck, c->map_vals, (c->map_mask + 1) * sizeof(int)) < 0 ||
+        checkpoint_blob(ck, c->seen, (c->seen_mask + 1) * sizeof(uint32_t)) < 0)
+        return -1;
+    return 0;
+}
+
+/*
+ * Everything hanging off the simulator, after the struct itself.  Reading,
+ * the struct already has this instance's pointers back, so every blob
+ * lands in a table of the size it was saved from.
+ */
+static int checkpoint_tables(checkpoint_t *ck, iplc_sim_t *sim)
+{
+    cache_t *caches[4] = {&sim->icache, &sim->dcache, &sim->l2, &sim->l3};
+    prefetcher_t *prefetchers[2] = {&sim->icache_prefetch, &sim->dcache_prefetch};
+    profile_t *p = &sim->profile;
+    intervals_t *iv = &sim->intervals;
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        if (checkpoint_blob(ck, caches[i]->store, caches[i]->store_size) < 0)
+            return -1;
+        if (caches[i]->classifier && checkpoint_classifier(ck, caches[i]->classifier) < 0)
+            return -1;
+    }
+    for (i = 0; i < 2; i++)
+        if (prefetchers[i]->policy &&
+            checkpoint_blob(ck, prefetchers[i]->state, prefetchers[i]->policy->state_size(prefetchers[i])) < 0)
+            return -1;
+    if (checkpoint_blob(ck, sim->bp.store, sim->bp.store_size) < 0 ||
+        checkpoint_blob(ck, sim->ooo.store, sim->ooo.store_size) < 0)
+        return -1;
+    if (p->keys) {
+        if (checkpoint_resize(ck, (void **) &p->keys, p->mask + 1, sizeof(uint32_t)) < 0 ||
+            checkpoint_resize(ck, (void **) &p->entries, p->mask + 1, sizeof(iplc_profile_entry_t)) < 0)
+            return -1;
+        if (checkpoint_blob(ck, p->keys, (p->mask + 1) * sizeof(uint32_t)) < 0 ||
+            checkpoint_blob(ck, p->entries, (p->mask + 1) * sizeof(iplc_profile_entry_t)) < 0)
+            return -1;
+    }
+    if (iv->dims && (checkpoint_blob(ck, iv->bbv, iv->dims * sizeof(uint32_t)) < 0 ||
+                     checkpoint_blob(ck, iv->phase, MAX_PHASES * iv->dims * sizeof(float)) < 0))
+        return -1;
+    return 0;
+}
+
+/*
+ * Save the whole state of sim to file_name: the struct with its latches,
+ * counters and inline tables, then every table it allocated.  records and
+ * offset say where in the trace it is, for iplc_sim_restore() to hand back.
+ * The file is written beside file_name and renamed over it, so an earlier
+ * checkpoint survives a failed write.  Returns -1 after saying what failed.
+ */
+int iplc_sim_checkpoint(iplc_sim_t *sim, const char *file_name, uint64_t records, uint64_t offset)
+{
+    checkpoint_header_t header;
+    checkpoint_t ck;
+    char temp_name[1024];
+    int failed;
+
+    // what is buffered for the output files belongs to the run so far
+    if ((sim->event_buffer && iplc_sim_flush_events(sim) < 0) ||
+        (sim->intervals.ring && iplc_sim_flush_intervals(sim) < 0)) {
+        printf("Writing buffered output failed before checkpoint %s \n", file_name);
+        return -1;
+    }
+
+    snprintf(temp_name, sizeof(temp_name), "%s.tmp", file_name);
+    bzero(&ck, sizeof(ck));
+    ck.out = fopen(temp_name, "wb");
+    if (ck.out == NULL) {
+        printf("fopen failed for %s file\n", temp_name);
+        return -1;
+    }
+
+    bzero(&header, sizeof(header));
+    memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+    header.version = CHECKPOINT_VERSION;
+    header.sim_size = sizeof(iplc_sim_t);
+    header.records = records;
+    header.offset = offset;
+    failed = fwrite(&header, sizeof(header), 1, ck.out) != 1 ||
+             checkpoint_blob(&ck, sim, sizeof(iplc_sim_t)) < 0 ||
+             checkpoint_tables(&ck, sim) < 0;
+    if ((ferror(ck.out) | fclose(ck.out)) || failed || rename(temp_name, file_name) < 0) {
+        printf("Writing checkpoint %s failed \n", file_name);
+        unlink(temp_name);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * What a checkpoint's configuration has to share with the one it is
+ * restored under: everything that sizes or interprets the saved state.
+ * Latencies, event tracing and where output goes may differ.
+ */
+static const char *checkpoint_config_error(const iplc_sim_config_t *saved, const iplc_sim_config_t *config)
+{
+    const iplc_cache_config_t *a[4] = {&saved->icache, &saved->dcache, &saved->l2, &saved->l3};
+    const iplc_cache_config_t *b[4] = {&config->icache, &config->dcache, &config->l2, &config->l3};
+    int i;
+
+    if (saved->levels != config->levels)
+        return "Checkpoint has another number of cache levels";
+    for (i = 0; i < 2 + (saved->levels - 1); i++)
+        if (a[i]->index != b[i]->index || a[i]->blocksize != b[i]->blocksize || a[i]->assoc != b[i]->assoc ||
+            a[i]->policy != b[i]->policy || (i > 1 && a[i]->inclusion != b[i]->inclusion))
+            return "Checkpoint has another cache geometry or policy";
+    if (saved->predictor != config->predictor || saved->bp_table_bits != config->bp_table_bits ||
+        saved->bp_history_bits != config->bp_history_bits || saved->bp_chooser_bits != config->bp_chooser_bits ||
+        saved->btb_entries != config->btb_entries || saved->ras_depth != config->ras_depth ||
+        saved->branch_predict_taken != config->branch_predict_taken)
+        return "Checkpoint has another branch predictor";
+    if (saved->hazards != config->hazards || saved->pipeline_depth != config->pipeline_depth ||
+        saved->issue_width != config->issue_width || saved->rob_entries != config->rob_entries ||
+        saved->iq_entries != config->iq_entries || saved->lsq_entries != config->lsq_entries)
+        return "Checkpoint has another pipeline";
+    if (saved->mshrs != config->mshrs || saved->write_policy != config->write_policy ||
+        saved->write_allocate != config->write_allocate || saved->write_buffer != config->write_buffer)
+        return "Checkpoint has other MSHRs or write policy";
+    if (memcmp(&saved->icache_prefetch, &config->icache_prefetch, sizeof(iplc_prefetch_config_t)) != 0 ||
+        memcmp(&saved->dcache_prefetch, &config->dcache_prefetch, sizeof(iplc_prefetch_config_t)) != 0)
+        return "Checkpoint has other prefetchers";
+    if (saved->classify_misses != config->classify_misses || saved->profile != config->profile ||
+        saved->interval != config->interval || saved->interval_unit != config->interval_unit ||
+        saved->bbv_dims != config->bbv_dims)
+        return "Checkpoint has other miss classification, profile or intervals";
+    if (saved->sample_window != config->sample_window || saved->sample_warmup != config->sample_warmup ||
+        saved->sample_period != config->sample_period || saved->num_simpoints != config->num_simpoints)
+        return "Checkpoint has other sampling";
+    return NULL;
+}
+
+/*
+ * Put back what the struct copied out of a checkpoint cannot keep: every
+ * pointer of this instance, and the settings config may change.
+ */
+static void checkpoint_relink(iplc_sim_t *sim, const iplc_sim_t *fresh)
+{
+    cache_t *caches[4] = {&sim->icache, &sim->dcache, &sim->l2, &sim->l3};
+    const cache_t *fresh_caches[4] = {&fresh->icache, &fresh->dcache, &fresh->l2, &fresh->l3};
+    int i;
+
+    sim->config = fresh->config;
+    sim->out = fresh->out;
+    sim->memory_latency = fresh->memory_latency;
+    for (i = 0; i < 4; i++) {
+        caches[i]->name = fresh_caches[i]->name;
+        caches[i]->latency = fresh_caches[i]->latency;
+        caches[i]->simd = fresh_caches[i]->simd;
+        caches[i]->policy = fresh_caches[i]->policy;
+        caches[i]->store = fresh_caches[i]->store;
+        caches[i]->tags = fresh_caches[i]->tags;
+        caches[i]->valid = fresh_caches[i]->valid;
+        caches[i]->dirty = fresh_caches[i]->dirty;
+        caches[i]->prefetched = fresh_caches[i]->prefetched;
+        caches[i]->repl = fresh_caches[i]->repl;
+        caches[i]->prefetcher = fresh_caches[i]->prefetcher;
+        caches[i]->classifier = fresh_caches[i]->classifier;
+    }
+    memcpy(sim->lower, fresh->lower, sizeof(sim->lower));
+
+    sim->bp.store = fresh->bp.store;
+    sim->bp.btb_tag = fresh->bp.btb_tag;
+    sim->bp.btb_target = fresh->bp.btb_target;
+    sim->bp.ras = fresh->bp.ras;
+    sim->bp.bimodal = fresh->bp.bimodal;
+    sim->bp.gshare = fresh->bp.gshare;
+    sim->bp.chooser = fresh->bp.chooser;
+
+    sim->ooo.store = fresh->ooo.store;
+    sim->ooo.rob_commit = fresh->ooo.rob_commit;
+    sim->ooo.lsq_commit = fresh->ooo.lsq_commit;
+    sim->ooo.iq_heap = fresh->ooo.iq_heap;
+    sim->ooo.calendar_cycle = fresh->ooo.calendar_cycle;
+    sim->ooo.calendar_issue = fresh->ooo.calendar_issue;
+    sim->ooo.calendar_mem = fresh->ooo.calendar_mem;
+
+    sim->icache_prefetch.policy = fresh->icache_prefetch.policy;
+    sim->icache_prefetch.state = fresh->icache_prefetch.state;
+    sim->dcache_prefetch.policy = fresh->dcache_prefetch.policy;
+    sim->dcache_prefetch.state = fresh->dcache_prefetch.state;
+
+    // the profile tables are resized to the saved mask as they are read
+    sim->profile.keys = fresh->profile.keys;
+    sim->profile.entries = fresh->profile.entries;
+    sim->profile.sorted = fresh->profile.sorted;
+
+    sim->intervals.out = fresh->intervals.out;
+    sim->intervals.binary = fresh->intervals.binary;
+    sim->intervals.bbv = fresh->intervals.bbv;
+    sim->intervals.ring = fresh->intervals.ring;
+    sim->intervals.ring_bbv = fresh->intervals.ring_bbv;
+    sim->intervals.ring_count = 0;
+    sim->intervals.phase = fresh->intervals.phase;
+
+    sim->sampler.simpoints = fresh->sampler.simpoints;
+
+    sim->events = fresh->events;
+    sim->event_out = fresh->event_out;
+    sim->event_buffer = fresh->event_buffer;
+    sim->event_count = 0;
+}
+
+/*
+ * Build a simulator from config and bring it to the state saved in
+ * file_name, which config has to match in everything but latencies and
+ * output.  The file is mapped and each part copied straight into place.
+ * Sets records and offset to where in the trace to carry on.  Returns NULL
+ * after saying what is wrong.
+ */
+iplc_sim_t *iplc_sim_restore(const char *file_name, const iplc_sim_config_t *config,
+                             uint64_t *records, uint64_t *offset)
+{
+    iplc_sim_t *sim = NULL, *fresh = NULL;
+    const checkpoint_header_t *header;
+    const char *error = NULL;
+    checkpoint_t ck;
+    struct stat st;
+    void *map;
+    int fd;
+
+    fd = open(file_name, O_RDONLY);
+    if (fd < 0) {
+        printf("open failed for %s file\n", file_name);
+        return NULL;
+    }
+    if (fstat(fd, &st) < 0 || st.st_size < sizeof(checkpoint_header_t)) {
+        printf("%s is not a checkpoint \n", file_name);
+        close(fd);
+        return NULL;
+    }
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        printf("mmap failed for %s file\n", file_name);
+        return NULL;
+    }
+
+    header = (const checkpoint_header_t *) map;
+    if (memcmp(header->magic, CHECKPOINT_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != CHECKPOINT_VERSION || header->sim_size != sizeof(iplc_sim_t)) {
+        printf("%s is not a checkpoint of this simulator version \n", file_name);
+        munmap(map, st.st_size);
+        return NULL;
+    }
+
+    bzero(&ck, sizeof(ck));
+    ck.at = (const char *) (header + 1);
+    ck.end = (const char *) map + st.st_size;
+    sim = iplc_sim_create(config);
+    fresh = (iplc_sim_t *) malloc(sizeof(iplc_sim_t));
+    if (sim == NULL || fresh == NULL) {
+        printf("Out of memory restoring %s \n", file_name);
+        munmap(map, st.st_size);
+        free(fresh);
+        iplc_sim_destroy(sim);
+        return NULL;
+    }
+
+    *fresh = *sim;
+    if (checkpoint_blob(&ck, sim, sizeof(iplc_sim_t)) < 0)
+        error = "Truncated checkpoint";
+    else
+        error = checkpoint_config_error(&sim->config, config);
+    checkpoint_relink(sim, fresh);
+    if (error == NULL && checkpoint_tables(&ck, sim) < 0)
+        error = "Checkpoint does not fit this configuration";
+    *records = header->records;
+    *offset = header->offset;
+    munmap(map, st.st_size);
+    free(fresh);
+    if (error) {
+        printf("%s: %s \n", file_name, error);
+        // the pointers are this instance's again, so it frees as usual
+        iplc_sim_destroy(sim);
+        return NULL;
+    }
+    return sim;
+}
@@ -0,0 +1,209 @@
+/***********************************************************************/
+/***********************************************************************
+ Pipeline Cache Simulator -- 3C miss classification
+ ***********************************************************************/
+/***********************************************************************/
+#include "iplc-internal.h"
+
+/************************************************************************************************/
+/* Classification Functions *********************************************************************/
+/************************************************************************************************/
+
+/*
+ * Both maps use linear probing on block + 1 (0 is empty), hashed the way
+ * the stack distance analysis does.
+ */
+static unsigned int classify_hash(uint32_t key, unsigned int mask)
+{
+    return (key * 2654435761U) & mask;
+}
+
+/*
+ * Size a classifier for a cache of blocks blocks.  Returns -1 if memory
+ * runs out.
+ */
+int iplc_sim_init_classifier(classifier_t *c, int blocks)
+{
+    unsigned int map_size = 16;
+
+    bzero(c, sizeof(classifier_t));
+    while (map_size < 2 * (unsigned int) blocks)
+        map_size <<= 1;
+    c->blocks = blocks;
+    c->head = -1;
+    c->map_mask = map_size - 1;
+    c->seen_mask = 8191;
+
+    c->block = (uint32_t *) malloc(blocks * sizeof(uint32_t));
+    c->prev = (int *) malloc(blocks * sizeof(int));
+    c->next = (int *) malloc(blocks * sizeof(int));
+    c->map_keys = (uint32_t *) calloc(map_size, sizeof(uint32_t));
+    c->map_vals = (int *) calloc(map_size, sizeof(int));
+    c->seen = (uint32_t *) calloc(c->seen_mask + 1, sizeof(uint32_t));
+    if (!c->block || !c->prev || !c->next || !c->map_keys || !c->map_vals || !c->seen) {
+        iplc_sim_free_classifier(c);
+        return -1;
+    }
+    return 0;
+}
+
+void iplc_sim_free_classifier(classifier_t *c)
+{
+    free(c->block);
+    free(c->prev);
+    free(c->next);
+    free(c->map_keys);
+    free(c->map_vals);
+    free(c->seen);
+    bzero(c, sizeof(classifier_t));
+}
+
+/*
+ * Add block to the blocks ever touched.  Returns 1 if it was not there yet.
+ * The set doubles once it is half full; should that fail it stays as it
+ * is and a block it has no room for keeps counting as new.
+ */
+static int classify_first_touch(classifier_t *c, uint32_t block)
+{
+    uint32_t *old = c->seen, key = block + 1;
+    unsigned int i, old_mask = c->seen_mask;
+
+    for (i = classify_hash(key, c->seen_mask); c->seen[i]; i = (i + 1) & c->seen_mask)
+        if (c->seen[i] == key)
+            return 0;
+
+    if (2 * (c->seen_count + 1) > c->seen_mask + 1) {
+        c->seen = (uint32_t *) calloc(2 * (old_mask + 1), sizeof(uint32_t));
+        if (c->seen == NULL) {
+            c->seen = old;
+            return 1;
+        }
+        c->seen_mask = 2 * old_mask + 1;
+        for (i = 0; i <= old_mask; i++) {
+            unsigned int j;
+
+            if (old[i] == 0)
+                continue;
+            for (j = classify_hash(old[i], c->seen_mask); c->seen[j]; j = (j + 1) & c->seen_mask)
+                ;
+            c->seen[j] = old[i];
+        }
+        free(old);
+        for (i = classify_hash(key, c->seen_mask); c->seen[i]; i = (i + 1) & c->seen_mask)
+            ;
+    }
+    c->seen[i] = key;
+    c->seen_count++;
+    return 1;
+}
+
+/*
+ * Slot of block in the shadow map, or of the empty slot it would go in.
+ */
+static unsigned int shadow_slot(const classifier_t *c, uint32_t block)
+{
+    unsigned int i;
+
+    for (i = classify_hash(block + 1, c->map_mask); c->map_vals[i]; i = (i + 1) & c->map_mask)
+        if (c->map_keys[i] == block + 1)
+            break;
+    return i;
+}
+
+/*
+ * Take block out of the shadow map, shifting back whatever probed past it
+ * so no tombstones are needed.
+ */
+static void shadow_remove(classifier_t *c, uint32_t block)
+{
+    unsigned int i = shadow_slot(c, block), j = i, home;
+
+    for (;;) {
+        j = (j + 1) & c->map_mask;
+        if (c->map_vals[j] == 0)
+            break;
+        home = classify_hash(c->map_keys[j], c->map_mask);
+        // move j back to i unless its home lies cyclically in (i, j]
+        if (i <= j ? (home <= i || home > j) : (home <= i && home > j)) {
+            c->map_keys[i] = c->map_keys[j];
+            c->map_vals[i] = c->map_vals[j];
+            i = j;
+        }
+    }
+    c->map_vals[i] = 0;
+}
+
+static void shadow_unlink(classifier_t *c, int node)
+{
+    c->next[c->prev[node]] = c->next[node];
+    c->prev[c->next[node]] = c->prev[node];
+    if (c->head == node)
+        c->head = c->next[node] == node ? -1 : c->next[node];
+}
+
+static void shadow_push(classifier_t *c, int node)
+{
+    if (c->head < 0) {
+        c->prev[node] = c->next[node] = node;
+    }
+    else {
+        c->next[node] = c->head;
+        c->prev[node] = c->prev[c->head];
+        c->next[c->prev[c->head]] = node;
+        c->prev[c->head] = node;
+    }
+    c->head = node;
+}
+
+/*
+ * Access block in the fully associative LRU shadow: a circular list in
+ * recency order, MRU at head, found through the map.  Returns 1 for a hit.
+ */
+static int shadow_access(classifier_t *c, uint32_t block)
+{
+    unsigned int i = shadow_slot(c, block);
+    int node;
+
+    if (c->map_vals[i]) {
+        node = c->map_vals[i] - 1;
+        if (node != c->head) {
+            shadow_unlink(c, node);
+            shadow_push(c, node);
+        }
+        return 1;
+    }
+
+    if (c->used < c->blocks)
+        node = c->used++;
+    else {
+        node = c->prev[c->head];
+        shadow_unlink(c, node);
+        shadow_remove(c, c->block[node]);
+        i = shadow_slot(c, block);
+    }
+    c->block[node] = block;
+    c->map_keys[i] = block + 1;
+    c->map_vals[i] = node + 1;
+    shadow_push(c, node);
+    return 0;
+}
+
+/*
+ * Run one access to the real cache past the classifier.  A miss on a block
+ * never touched before is compulsory, one the shadow also misses is
+ * capacity, and the rest are conflict misses.
+ */
+void iplc_sim_classify(classifier_t *c, uint32_t block, int hit)
+{
+    int first = classify_first_touch(c, block);
+    int shadow_hit = shadow_access(c, block);
+
+    if (hit)
+        return;
+    if (first)
+        c->compulsory++;
+    else if (!shadow_hit)
+        c->capacity++;
+    else
+        c->conflict++;
+}
@@ -0,0 +1,233 @@
+/***********************************************************************/
+/***********************************************************************
+ Pipeline Cache Simulator -- compressed trace streams
+ ***********************************************************************/
+/***********************************************************************/
+#define _GNU_SOURCE
+#include <zlib.h>
+#ifdef IPLC_ZSTD
+#include <zstd.h>
+#endif
+
+#include "iplc-internal.h"
+
+/************************************************************************************************/
+/* Stream Functions *****************************************************************************/
+/************************************************************************************************/
+
+/*
+ * A trace stream behind a stdio FILE, so the reader thread, the converter
+ * and everything else keep using fgets() and fread() and the decompression
+ * happens a block at a time on whichever thread reads.  The first bytes
+ * were read to look for a magic, and plain streams hand those back first.
+ */
+#define COMPRESSED_BLOCK 65536
+
+enum compression {COMPRESSION_NONE, COMPRESSION_GZIP, COMPRESSION_ZSTD};
+
+typedef struct compressed
+{
+    FILE          *in;
+    int           type;             // enum compression
+    int           close_in;         // in is not stdin
+    unsigned char block[COMPRESSED_BLOCK];
+    size_t        length;           // bytes in block
+    size_t        used;             // of them already handed on
+    int           end;              // in has nothing more
+    z_stream      gzip;
+#ifdef IPLC_ZSTD
+    ZSTD_DStream  *zstd;
+    int           in_frame;         // a frame is started and not finished
+#endif
+} compressed_t;
+
+/*
+ * Read the next block of in once the last one is used up.  Returns 0 at
+ * the end of in.
+ */
+static size_t compressed_refill(compressed_t *c)
+{
+    if (c->used < c->length)
+        return c->length - c->used;
+    c->used = 0;
+    c->length = c->end ? 0 : fread(c->block, 1, COMPRESSED_BLOCK, c->in);
+    if (c->length < COMPRESSED_BLOCK)
+        c->end = 1;
+    return c->length;
+}
+
+/*
+ * Output can be held back inside the decompressor after the input runs
+ * out, so it is asked once more before a stream ends; one that ends in
+ * the middle of a member or frame is cut short.
+ */
+static ssize_t compressed_gzip(compressed_t *c, char *buffer, size_t size)
+{
+    size_t more;
+    int status;
+
+    c->gzip.next_out = (Bytef *) buffer;
+    c->gzip.avail_out = (uInt) size;
+    while (c->gzip.avail_out == size) {
+        more = compressed_refill(c);
+        // total_in goes back to 0 between members
+        if (more == 0 && c->gzip.total_in == 0)
+            break;
+        c->gzip.next_in = c->block + c->used;
+        c->gzip.avail_in = (uInt) more;
+        status = inflate(&c->gzip, Z_NO_FLUSH);
+        c->used = c->length - c->gzip.avail_in;
+        // gzip files can be several members back to back
+        if (status == Z_STREAM_END)
+            status = inflateReset(&c->gzip);
+        else if (more == 0 && c->gzip.avail_out == size) {
+            printf("gzip trace is cut short \n");
+            return -1;
+        }
+        if (status != Z_OK && status != Z_BUF_ERROR) {
+            printf("Corrupt gzip trace \n");
+            return -1;
+        }
+    }
+    return (ssize_t) (size - c->gzip.avail_out);
+}
+
+#ifdef IPLC_ZSTD
+static ssize_t compressed_zstd(compressed_t *c, char *buffer, size_t size)
+{
+    ZSTD_outBuffer out = {buffer, size, 0};
+    ZSTD_inBuffer in;
+    size_t more, status;
+
+    while (out.pos == 0) {
+        more = compressed_refill(c);
+        if (more == 0 && !c->in_frame)
+            break;
+        in.src = c->block;
+        in.size = c->length;
+        in.pos = c->used;
+        status = ZSTD_decompressStream(c->zstd, &out, &in);
+        c->used = in.pos;
+        if (ZSTD_isError(status)) {
+            printf("Corrupt zstd trace: %s \n", ZSTD_getErrorName(status));
+            return -1;
+        }
+        // 0 once a frame is complete and flushed
+        c->in_frame = status != 0;
+        if (more == 0 && out.pos == 0 && c->in_frame) {
+            printf("zstd trace is cut short \n");
+            return -1;
+        }
+    }
+    return (ssize_t) out.pos;
+}
+#endif
+
+static ssize_t compressed_read(void *cookie, char *buffer, size_t size)
+{
+    compressed_t *c = (compressed_t *) cookie;
+    size_t count;
+
+    switch (c->type) {
+        case COMPRESSION_GZIP:
+            return compressed_gzip(c, buffer, size);
+#ifdef IPLC_ZSTD
+        case COMPRESSION_ZSTD:
+            return compressed_zstd(c, buffer, size);
+#endif
+        default:
+            if (c->used < c->length) {
+                count = c->length - c->used < size ? c->length - c->used : size;
+                memcpy(buffer, c->block + c->used, count);
+                c->used += count;
+                return (ssize_t) count;
+            }
+            count = fread(buffer, 1, size, c->in);
+            return count == 0 && ferror(c->in) ? -1 : (ssize_t) count;
+    }
+}
+
+static int compressed_close(void *cookie)
+{
+    compressed_t *c = (compressed_t *) cookie;
+
+    if (c->type == COMPRESSION_GZIP)
+        inflateEnd(&c->gzip);
+#ifdef IPLC_ZSTD
+    if (c->zstd)
+        ZSTD_freeDStream(c->zstd);
+#endif
+    if (c->close_in)
+        fclose(c->in);
+    free(c);
+    return 0;
+}
+
+/*
+ * Open a trace for reading, "-" for stdin.  gzip and zstd streams are
+ * recognized by their magic and decompressed as they are read; zstd needs
+ * a build with ZSTD=1.  A plain file comes back as it is, so it can still
+ * seek.  Returns NULL after saying what is wrong.
+ */
+FILE *iplc_sim_open_trace(const char *file_name)
+{
+    static const unsigned char gzip_magic[2] = {0x1f, 0x8b};
+    static const unsigned char zstd_magic[4] = {0x28, 0xb5, 0x2f, 0xfd};
+    cookie_io_functions_t functions = {compressed_read, NULL, NULL, compressed_close};
+    compressed_t *c = NULL;
+    FILE *f;
+
+    c = (compressed_t *) calloc(1, sizeof(compressed_t));
+    if (c == NULL) {
+        printf("Out of memory opening %s \n", file_name);
+        return NULL;
+    }
+    c->close_in = strcmp(file_name, "-") != 0;
+    c->in = c->close_in ? fopen(file_name, "rb") : stdin;
+    if (c->in == NULL) {
+        printf("fopen failed for %s file\n", file_name);
+        free(c);
+        return NULL;
+    }
+
+    c->length = fread(c->block, 1, sizeof(zstd_magic), c->in);
+    if (c->length >= sizeof(gzip_magic) && memcmp(c->block, gzip_magic, sizeof(gzip_magic)) == 0) {
+        // 15 window bits plus 32 takes a gzip or zlib header
+        c->type = COMPRESSION_GZIP;
+        if (inflateInit2(&c->gzip, 15 + 32) != Z_OK) {
+            printf("Out of memory opening %s \n", file_name);
+            c->type = COMPRESSION_NONE;
+            compressed_close(c);
+            return NULL;
+        }
+    }
+    else if (c->length == sizeof(zstd_magic) && memcmp(c->block, zstd_magic, sizeof(zstd_magic)) == 0) {
+#ifdef IPLC_ZSTD
+        c->type = COMPRESSION_ZSTD;
+        c->zstd = ZSTD_createDStream();
+        if (c->zstd == NULL || ZSTD_isError(ZSTD_initDStream(c->zstd))) {
+            printf("Out of memory opening %s \n", file_name);
+            compressed_close(c);
+            return NULL;
+        }
+#else
+        printf("%s is zstd compressed, which needs a build with make ZSTD=1 \n", file_name);
+        compressed_close(c);
+        return NULL;
+#endif
+    }
+    else if (c->close_in) {
+        // a plain file needs none of this
+        f = c->in;
+        free(c);
+        rewind(f);
+        return f;
+    }
+
+    f = fopencookie(c, "r", functions);
+    if (f == NULL) {
+        printf("Out of memory opening %s \n", file_name);
+        compressed_close(c);
+    }
+    return f;
+}
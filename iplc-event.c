@@ -0,0 +1,215 @@
+/***********************************************************************/
+/***********************************************************************
+ Pipeline Cache Simulator -- event tracing
+ ***********************************************************************/
+/***********************************************************************/
+#include "iplc-internal.h"
+
+const char *event_category_names[NUM_EVENT_CATEGORIES] = {
+    "config", "address", "fetch", "data", "lower", "pipeline", "retire"
+};
+
+// by the flag of a CONFIG event
+static const char *event_cache_names[4] = {"I-Cache", "D-Cache", "L2", "L3"};
+
+/*
+ * The categories each level turns on, see enum event_category.
+ */
+unsigned int iplc_sim_event_level(int level)
+{
+    unsigned int events = 0;
+
+    if (level >= 1)
+        events |= EVENT_CONFIG | EVENT_FETCH | EVENT_DATA | EVENT_LOWER;
+    if (level >= 2)
+        events |= EVENT_ADDRESS;
+    if (level >= 3)
+        events |= EVENT_PIPELINE;
+    if (level >= 4)
+        events |= EVENT_RETIRE;
+    return events;
+}
+
+/*
+ * Turn a comma separated list of category names into a mask, -1 if one of
+ * them is not a category.
+ */
+int iplc_sim_events_by_name(const char *names)
+{
+    const char *name = names;
+    size_t length;
+    int events = 0, i;
+
+    while (*name) {
+        length = strcspn(name, ",");
+        for (i = 0; i < NUM_EVENT_CATEGORIES; i++)
+            if (strlen(event_category_names[i]) == length &&
+                strncmp(name, event_category_names[i], length) == 0)
+                break;
+        if (i == NUM_EVENT_CATEGORIES)
+            return -1;
+        events |= 1 << i;
+        name += length;
+        if (*name == ',')
+            name++;
+    }
+    return events;
+}
+
+/************************************************************************************************/
+/* Event Functions ******************************************************************************/
+/************************************************************************************************/
+
+/*
+ * Set up the sim's event state from config.  With an event file the header
+ * goes out now and records are buffered.  Returns -1 if memory runs out or
+ * the header cannot be written.
+ */
+int iplc_sim_init_events(iplc_sim_t *sim, const iplc_sim_config_t *config)
+{
+    event_header_t header;
+
+#ifndef IPLC_NO_EVENTS
+    sim->events = config->events;
+    sim->event_out = config->event_out;
+#endif
+    if (sim->event_out == NULL)
+        return 0;
+
+    sim->event_buffer = (event_record_t *) malloc(EVENT_BUFFER_RECORDS * sizeof(event_record_t));
+    if (sim->event_buffer == NULL)
+        return -1;
+
+    bzero(&header, sizeof(header));
+    memcpy(header.magic, EVENT_MAGIC, sizeof(EVENT_MAGIC));
+    header.version = EVENT_VERSION;
+    header.record_size = sizeof(event_record_t);
+    if (fwrite(&header, sizeof(header), 1, sim->event_out) != 1)
+        return -1;
+    return 0;
+}
+
+/*
+ * Write out the buffered records.  Returns -1 if the write fails.
+ */
+int iplc_sim_flush_events(iplc_sim_t *sim)
+{
+    size_t count = sim->event_count;
+
+    sim->event_count = 0;
+    if (count && fwrite(sim->event_buffer, sizeof(event_record_t), count, sim->event_out) != count)
+        return -1;
+    return 0;
+}
+
+void iplc_sim_free_events(iplc_sim_t *sim)
+{
+    if (sim->event_buffer)
+        iplc_sim_flush_events(sim);
+    free(sim->event_buffer);
+    sim->event_buffer = NULL;
+}
+
+/*
+ * The configuration block of one cache, as the cache was set up.
+ */
+static void iplc_sim_format_config(FILE *out, const event_record_t *ev)
+{
+    int index = ev->a >> 24, assoc = ev->a & 0xffff, policy = ev->itype & 0xff, inclusion = ev->itype >> 8;
+
+    fprintf(out, "%s Configuration \n", event_cache_names[ev->flag & 3]);
+    fprintf(out, "   Index: %d bits or %d lines \n", index, (1<<index) );
+    fprintf(out, "   BlockSize: %u \n", ev->b );
+    fprintf(out, "   Associativity: %d \n", assoc );
+    fprintf(out, "   BlockOffSetBits: %u \n", (ev->a >> 16) & 0xff );
+    fprintf(out, "   CacheSize: %lu \n", iplc_sim_cache_size(index, (int) ev->b, assoc) );
+    if (policy < NUM_POLICIES)
+        fprintf(out, "   Replacement: %s \n", policy_names[policy] );
+    fprintf(out, "   Latency: %d \n", (int) ev->c );
+    if (ev->flag >= 2 && inclusion < NUM_INCLUSIONS)
+        fprintf(out, "   Inclusion: %s \n", inclusion_names[inclusion] );
+}
+
+/*
+ * Print one event exactly as the simulator always has.
+ */
+void iplc_sim_format_event(FILE *out, const event_record_t *ev)
+{
+    switch (ev->type) {
+        case EVENT_TYPE_CONFIG:
+            iplc_sim_format_config(out, ev);
+            break;
+        case EVENT_TYPE_ADDRESS:
+            fprintf(out, "Address %x: Tag= %x, Index= %x\n", ev->a, ev->b, ev->c);
+            break;
+        case EVENT_TYPE_FETCH:
+            fprintf(out, "INST %s:\t Address 0x%x \n", ev->flag ? "HIT" : "MISS", ev->a);
+            break;
+        case EVENT_TYPE_LW:
+            fprintf(out, "DATA %s Address 0x%x\n", ev->flag ? "HIT" : "MISS", ev->a);
+            break;
+        case EVENT_TYPE_SW:
+            fprintf(out, "DATA %s Address 0x%x", ev->flag ? "HIT" : "MISS", ev->a);
+            break;
+        case EVENT_TYPE_LOWER:
+            fprintf(out, "L%u %s Address 0x%x\n", ev->b, ev->flag ? "HIT" : "MISS", ev->a);
+            break;
+        case EVENT_TYPE_STAGE:
+            // c is stage << 16 | issue width << 8 | slot; a row starts at
+            // the first slot of stage 0 and ends with the last one in WB
+            switch (ev->flag) {
+                case FETCH:
+                    if ((ev->c >> 16) == 0 && (ev->c & 0xff) == 0)
+                        fprintf(out, "(cyc: %u) FETCH:\t %d: 0x%x \t", ev->b, ev->itype, ev->a);
+                    else
+                        fprintf(out, "FETCH:\t %d: 0x%x \t", ev->itype, ev->a);
+                    break;
+                case DECODE:
+                    fprintf(out, "DECODE:\t %d: 0x%x \t", ev->itype, ev->a);
+                    break;
+                case ALU:
+                    fprintf(out, "ALU:\t %d: 0x%x \t", ev->itype, ev->a);
+                    break;
+                case MEM:
+                    fprintf(out, "MEM:\t %d: 0x%x \t", ev->itype, ev->a);
+                    break;
+                default:
+                    fprintf(out, "WB:\t %d: 0x%x %c", ev->itype, ev->a,
+                            (ev->c & 0xff) + 1 == ((ev->c >> 8) & 0xff) ? '\n' : '\t');
+                    break;
+            }
+            break;
+        case EVENT_TYPE_RETIRE:
+            fprintf(out, "DEBUG: Retired Instruction at 0x%x, Type %d, at Time %u \n", ev->a, ev->itype, ev->b);
+            break;
+        default:
+            fprintf(out, "Unknown event %d \n", ev->type);
+            break;
+    }
+}
+
+/*
+ * Offline decoder: print every record of a binary event file as text.
+ * Returns -1 if in is not an event file.
+ */
+int iplc_sim_decode_events(FILE *in, FILE *out)
+{
+    event_header_t header;
+    event_record_t *records = NULL;
+    size_t count, i;
+
+    if (fread(&header, sizeof(header), 1, in) != 1 || memcmp(header.magic, EVENT_MAGIC, sizeof(EVENT_MAGIC)) ||
+        header.version != EVENT_VERSION || header.record_size != sizeof(event_record_t)) {
+        printf("Not an event file \n");
+        return -1;
+    }
+
+    records = (event_record_t *) malloc(EVENT_BUFFER_RECORDS * sizeof(event_record_t));
+    if (records == NULL)
+        return -1;
+    while ((count = fread(records, sizeof(event_record_t), EVENT_BUFFER_RECORDS, in)) > 0)
+        for (i = 0; i < count; i++)
+            iplc_sim_format_event(out, &records[i]);
+    free(records);
+    return 0;
+}
@@ -0,0 +1,590 @@
+/***********************************************************************/
+/***********************************************************************
+ Pipeline Cache Simulator internals, shared by the library sources
+ ***********************************************************************/
+/***********************************************************************/
+#ifndef IPLC_INTERNAL_H
+#define IPLC_INTERNAL_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <math.h>
+
+#include "iplc-sim.h"
+
+/*
+ * Ways are padded to a multiple of the SIMD width so every set's tags start
+ * on a 32 byte boundary and can be compared with aligned vector loads.
+ */
+#define CACHE_TAG_LANES 8
+
+typedef struct cache cache_t;
+typedef struct prefetcher prefetcher_t;
+
+/*
+ * 3C miss classification for one cache: the blocks ever touched, and a
+ * fully associative LRU shadow of the same capacity kept as a hash map
+ * onto a circular list of nodes in recency order.
+ */
+typedef struct classifier
+{
+    int           blocks;           // capacity of the shadow
+    int           used;
+    int           head;             // MRU node, -1 while empty
+    uint32_t      *block;           // [node]
+    int           *prev;
+    int           *next;
+    uint32_t      *map_keys;        // block + 1, 0 is empty
+    int           *map_vals;        // node + 1
+    unsigned int  map_mask;
+    uint32_t      *seen;            // block + 1, 0 is empty
+    unsigned int  seen_mask;
+    unsigned int  seen_count;
+
+    long          compulsory;
+    long          capacity;
+    long          conflict;
+} classifier_t;
+
+/*
+ * The hotspot profile: entries by instruction address in an open
+ * addressing table that doubles once half full, and the sorted copy
+ * iplc_sim_profile() last handed out.
+ */
+typedef struct profile
+{
+    uint32_t      *keys;            // pc + 1, 0 is empty; NULL when not profiling
+    iplc_profile_entry_t *entries;
+    unsigned int  mask;
+    unsigned int  count;
+    iplc_profile_entry_t *sorted;
+} profile_t;
+
+/*
+ * Interval statistics: the counter totals the open interval started from,
+ * its basic block vector, and finished intervals waiting in a ring for
+ * out.  Phases keep the normalized BBV of their first interval.
+ */
+#define INTERVAL_RING 256
+#define MAX_PHASES 64
+
+typedef struct intervals
+{
+    int           length;           // 0 when off
+    int           unit;             // enum interval_unit
+    int           dims;             // BBV dimensions, 0 for none
+    FILE          *out;
+    int           binary;
+    long          next;             // where the open interval ends, in unit
+    interval_record_t start;        // totals when it began
+    uint32_t      *bbv;             // [dims] for the open interval
+    unsigned int  block;            // dimension of the basic block being fetched
+    interval_record_t *ring;        // [INTERVAL_RING], only with out
+    uint32_t      *ring_bbv;        // [INTERVAL_RING][dims]
+    int           ring_count;
+    float         *phase;           // [MAX_PHASES][dims]
+    iplc_interval_stats_t stats;
+} intervals_t;
+
+/*
+ * Sampled simulation: where the trace is, whether the pipeline holds
+ * detailed work, the window being measured, and running weighted sums of
+ * the window CPIs.
+ */
+enum sample_mode {SAMPLE_FAST, SAMPLE_WARMUP, SAMPLE_MEASURE};
+
+typedef struct sampler
+{
+    long          window;           // 0 when not sampling
+    long          warmup;
+    long          period;           // 0 with simpoints
+    iplc_simpoint_t *simpoints;     // sorted by interval
+    int           num_simpoints;
+    int           next;             // first simpoint not over yet
+    long          position;         // instructions stepped so far
+    int           detailed;         // the pipeline holds detailed work
+    int           measuring;
+    long          window_id;        // period or simpoint of the open window
+    double        weight;
+    long          start_cycles;
+    long          start_instructions;
+    unsigned int  last_pc;          // of a fast-forwarded control instruction
+    double        sum_w, sum_w2, sum_wx, sum_wx2;
+    iplc_sample_stats_t stats;
+} sampler_t;
+
+/*
+ * A replacement policy: per set state of state_size() bytes, updated on hits
+ * and fills.  victim() is only asked once every way of the set is valid.
+ */
+typedef struct cache_policy
+{
+    size_t (*state_size)(const cache_t *cache);
+    void   (*init)(cache_t *cache, uint8_t *state);
+    void   (*hit)(cache_t *cache, uint8_t *state, int way);
+    int    (*victim)(cache_t *cache, uint8_t *state);
+    void   (*fill)(cache_t *cache, uint8_t *state, int way);
+} cache_policy_t;
+
+extern const cache_policy_t cache_policies[NUM_POLICIES];
+
+/*
+ * What iplc_sim_replace_on_miss() and iplc_sim_cache_fill() evicted.
+ */
+enum fill_result {FILL_EVICTED = 1, FILL_DIRTY = 2, FILL_PREFETCHED = 4};
+
+/*
+ * Struct-of-arrays tag store: one aligned allocation holding, per set, the
+ * packed tags, valid, dirty and prefetched bitmasks and the replacement
+ * policy state.
+ */
+struct cache
+{
+    int           index;            // index bits, 2^index sets
+    int           blocksize;
+    int           assoc;
+    int           blockoffsetbits;
+    unsigned int  set_mask;
+    int           tag_shift;
+    int           ways;             // assoc padded to CACHE_TAG_LANES
+    int           valid_words;      // 64 bit valid words per set
+    unsigned int  simd;             // compare tags with SIMD when built with it
+    const char    *name;            // "I-Cache", "D-Cache", "L2" or "L3" in verbose output
+    int           latency;
+    int           inclusion;
+
+    long          access;
+    long          miss;
+    long          hit;
+
+    const cache_policy_t *policy;
+    size_t        repl_stride;      // policy state bytes per set, multiple of 8
+    uint32_t      rng;
+    int           plru_leaves;      // assoc rounded up to a power of two
+    int           plru_levels;
+    uint64_t      way_mask[4];      // ways < assoc, per valid word
+
+    void          *store;
+    size_t        store_size;
+    uint32_t      *tags;            // [set * ways + way]
+    uint64_t      *valid;           // [set * valid_words + way / 64]
+    uint64_t      *dirty;           // same layout as valid
+    uint64_t      *prefetched;      // brought in by a prefetch and not used yet
+    uint8_t       *repl;            // [set * repl_stride], policy state
+    prefetcher_t  *prefetcher;      // NULL for none
+    classifier_t  *classifier;      // NULL unless misses are classified
+};
+
+/*
+ * Branch predictor tables, all in one allocation.
+ */
+typedef struct branch_predictor
+{
+    int           type;             // enum branch_predictor_type
+    unsigned int  predict_taken;    // static prediction
+    unsigned int  table_mask;
+    unsigned int  chooser_mask;
+    unsigned int  history;
+    unsigned int  history_mask;
+    unsigned int  btb_mask;
+    int           btb_entries;
+    int           ras_depth;
+    int           ras_top;          // next free slot, wraps and overwrites
+    int           ras_count;
+
+    void          *store;
+    size_t        store_size;
+    uint32_t      *btb_tag;         // branch address | 1, 0 when empty
+    uint32_t      *btb_target;
+    uint32_t      *ras;
+    uint8_t       *bimodal;         // 2-bit counters
+    uint8_t       *gshare;
+    uint8_t       *chooser;         // >= 2 picks gshare
+
+    iplc_branch_stats_t stats;
+} branch_predictor_t;
+
+enum mispredict {MISPREDICT_NONE, MISPREDICT_DIRECTION, MISPREDICT_BTB, MISPREDICT_RAS};
+
+enum hazard_cause {HAZARD_NONE, HAZARD_LOAD_USE, HAZARD_DATA, HAZARD_BRANCH, HAZARD_MISS_DECODE,
+                   HAZARD_MISS_ALU};
+
+/*
+ * A block in flight: the block fetched and the cycle it arrives.  Both a
+ * D-cache miss in an MSHR and a queued prefetch.
+ */
+typedef struct mshr
+{
+    unsigned int  block;
+    long          ready;
+} mshr_t;
+
+/*
+ * A write buffer entry: the block it writes and the cycle it has drained.
+ */
+typedef struct write_entry
+{
+    unsigned int  block;
+    long          done;
+} write_entry_t;
+
+#define PREFETCH_QUEUE 16
+#define PREFETCH_FILTER 1024
+
+/*
+ * A prefetcher: state of state_size() bytes, trained on every demand access
+ * to its cache with enum prefetch_outcome.  train() puts the addresses to
+ * prefetch in addresses, at most degree of them, and returns how many.
+ */
+typedef struct prefetch_policy
+{
+    size_t (*state_size)(const prefetcher_t *pf);
+    void   (*init)(prefetcher_t *pf);
+    int    (*train)(prefetcher_t *pf, unsigned int pc, unsigned int address, int outcome,
+                    unsigned int *addresses);
+} prefetch_policy_t;
+
+extern const prefetch_policy_t prefetch_policies[NUM_PREFETCHERS];
+
+enum prefetch_outcome {PREFETCH_MISS, PREFETCH_HIT, PREFETCH_FIRST_USE};
+
+/*
+ * The queue holds prefetches on their way, ready 0 once a slot is free.
+ * The filter remembers blocks prefetches evicted, as block + 1 indexed by
+ * block, to spot the demand misses they caused.
+ */
+struct prefetcher
+{
+    const prefetch_policy_t *policy;
+    int           degree;
+    int           entries;
+    int           block_bits;       // of the cache it fills
+    long          next_issue;       // one prefetch goes out per cycle
+    mshr_t        queue[PREFETCH_QUEUE];
+    uint32_t      filter[PREFETCH_FILTER];
+    void          *state;
+
+    iplc_prefetch_stats_t stats;
+};
+
+enum instruction_type {NOP, RTYPE, LW, SW, BRANCH, JUMP, JAL, SYSCALL};
+
+typedef struct rtype
+{
+    int reg1;
+    int reg2_or_constant;
+    int dest_reg;
+
+} rtype_t;
+
+typedef struct load_word
+{
+    unsigned int data_address;
+    int dest_reg;
+    int base_reg;
+
+} lw_t;
+
+typedef struct store_word
+{
+    unsigned int data_address;
+    int src_reg;
+    int base_reg;
+} sw_t;
+
+typedef struct branch
+{
+    int reg1;
+    int reg2;
+
+} branch_t;
+
+/*
+ * Registers an instruction reads and writes, -1 when unused, for the hazard
+ * scoreboard.  late_src is the sw value, which is not needed until MEM.
+ */
+typedef struct hazard_regs
+{
+    int dest;
+    int src[2];
+    int late_src;
+} hazard_regs_t;
+
+typedef struct pipeline
+{
+    enum instruction_type itype;
+    unsigned int instruction_address;
+    int mispredicted;               // enum mispredict, set once the next fetch is known
+    hazard_regs_t regs;
+    union
+    {
+        rtype_t   rtype;
+        lw_t      lw;
+        sw_t      sw;
+        branch_t  branch;
+    }
+    stage;
+
+} pipeline_t;
+
+enum pipeline_stages {FETCH, DECODE, ALU, MEM, WRITEBACK};
+
+#define OOO_QUEUE 256               // power of two, above MAX_PIPELINE_DEPTH * MAX_ISSUE_WIDTH
+#define OOO_CALENDAR 4096           // power of two
+
+/*
+ * An instruction handed to the out-of-order core, held until its D-cache
+ * latency is known and it can be timed.
+ */
+typedef struct ooo_entry
+{
+    enum instruction_type itype;
+    hazard_regs_t regs;
+    unsigned int  fetch_latency;
+    int           mispredicted;
+    int           mem_latency;      // -1 until the pipeline's MEM stage gets to it
+} ooo_entry_t;
+
+/*
+ * The out-of-order core: a timing model fed in program order that places
+ * every instruction's fetch, dispatch, issue, completion and commit cycle.
+ * Renaming leaves only true dependences, through reg_ready.  The ROB and the
+ * load/store queue free their entries in order, so rings of commit cycles
+ * hold them; the issue queue frees out of order and is a min-heap of issue
+ * cycles.  The calendar counts issue slots and the D-cache port per cycle.
+ */
+typedef struct ooo_core
+{
+    int           rob_entries;      // 0 when there is no out-of-order core
+    int           iq_entries;
+    int           lsq_entries;
+    int           width;
+    int           front_depth;      // fetch to dispatch, in cycles
+
+    ooo_entry_t   queue[OOO_QUEUE];
+    unsigned int  head;             // next to time
+    unsigned int  tail;             // next free
+    unsigned int  mem_next;         // first lw / sw still without a latency
+
+    long          count;            // instructions timed
+    long          mem_count;
+    long          fetch_cycle;
+    int           fetch_slots;
+    long          redirect;         // no fetch before this, after a mispredict
+    long          dispatch_cycle;
+    int           dispatch_slots;
+    long          commit_cycle;
+    int           commit_slots;
+    long          last_complete;
+    long          reg_ready[32];
+    int           iq_size;
+
+    void          *store;
+    size_t        store_size;
+    long          *rob_commit;      // [count % rob_entries]
+    long          *lsq_commit;      // [mem_count % lsq_entries]
+    long          *iq_heap;
+    long          *calendar_cycle;  // [cycle % OOO_CALENDAR]
+    uint8_t       *calendar_issue;
+    uint8_t       *calendar_mem;
+
+    iplc_ooo_stats_t stats;
+} ooo_core_t;
+
+/*
+ * A pipeline latch: the instructions of one issue group, oldest first.
+ */
+typedef struct stage
+{
+    int           count;
+    pipeline_t    slot[MAX_ISSUE_WIDTH];
+} stage_t;
+
+/*
+ * Everything one simulation touches.  Nothing in the library lives outside
+ * of this struct.
+ */
+struct iplc_sim
+{
+    iplc_sim_config_t config;
+    FILE          *out;
+
+    cache_t       icache;
+    cache_t       dcache;
+    cache_t       l2;
+    cache_t       l3;
+    cache_t       *lower[MAX_CACHE_LEVELS - 1];  // l2, l3 as configured
+    int           num_lower;
+    int           memory_latency;
+    long          memory_access;
+
+    unsigned int  instruction_address;
+    long          pipeline_cycles;   // how many cycles did you pipeline consume
+    long          instruction_count; // home many real instructions ran thru the pipeline
+    unsigned int  branch_predict_taken;
+    long          branch_count;
+    long          correct_branch_predictions;
+    branch_predictor_t bp;
+    int           last_opcode;      // of the instruction in FETCH
+    int           hazards;          // enum hazard_model
+    iplc_hazard_stats_t hazard;
+    ooo_core_t    ooo;
+    int           num_mshrs;        // 0 for a blocking D-cache
+    mshr_t        mshr[MAX_MSHRS];
+    long          mshr_busy_until;  // the last cycle any MSHR is in use
+    long          reg_ready[32];    // when a lw miss's data arrives, non-blocking only
+    iplc_mshr_stats_t mshr_stats;
+    int           write_policy;     // enum write_policy
+    int           write_allocate;
+    int           write_buffer;     // entries, 0 for none
+    write_entry_t write_entry[MAX_WRITE_BUFFER];
+    long          write_busy_until; // when the last buffered write drains
+    iplc_write_stats_t write_stats;
+    prefetcher_t  icache_prefetch;
+    prefetcher_t  dcache_prefetch;
+    profile_t     profile;
+    intervals_t   intervals;
+    sampler_t     sampler;
+
+    unsigned int  events;           // enum event_category, 0 under IPLC_NO_EVENTS
+    FILE          *event_out;
+    event_record_t *event_buffer;   // binary events waiting for event_out
+    size_t        event_count;
+
+    // Stage s lives at stages[(head + s) % depth]: stage 0 fetches, the
+    // ones up to decode are front end, and ALU, MEM and writeback are the
+    // last three.  A cycle moves every latch on by stepping head back.
+    stage_t       stages[MAX_PIPELINE_DEPTH];
+    int           head;
+    int           depth;
+    int           width;
+    int           decode;
+    int           alu;
+    int           mem;
+    int           writeback;
+};
+
+static inline stage_t *iplc_sim_stage(iplc_sim_t *sim, int stage)
+{
+    int slot = sim->head + stage;
+
+    return &sim->stages[slot < sim->depth ? slot : slot - sim->depth];
+}
+
+/*
+ * Guard for every event: one well predicted test when tracing is off, and
+ * nothing at all when it is compiled out.
+ */
+#ifdef IPLC_NO_EVENTS
+#define EVENT_ON(sim, category) 0
+#else
+#define EVENT_ON(sim, category) __builtin_expect(((sim)->events & (category)) != 0, 0)
+#endif
+
+#define EVENT_BUFFER_RECORDS 65536
+
+// every profile hook is one well predicted test while profiling is off
+#define PROFILE_ON(sim) __builtin_expect((sim)->profile.keys != NULL, 0)
+
+// Event functions
+int iplc_sim_init_events(iplc_sim_t *sim, const iplc_sim_config_t *config);
+int iplc_sim_flush_events(iplc_sim_t *sim);
+void iplc_sim_free_events(iplc_sim_t *sim);
+void iplc_sim_format_event(FILE *out, const event_record_t *ev);
+
+/*
+ * Record one event: straight into the buffer for an event file, otherwise
+ * formatted onto out as it always was.
+ */
+static inline void iplc_sim_event(iplc_sim_t *sim, int type, int flag, int itype,
+                                  uint32_t a, uint32_t b, uint32_t c)
+{
+    event_record_t local, *ev = &local;
+
+    if (sim->event_buffer) {
+        if (sim->event_count == EVENT_BUFFER_RECORDS)
+            iplc_sim_flush_events(sim);
+        ev = &sim->event_buffer[sim->event_count++];
+    }
+    ev->type = (uint8_t) type;
+    ev->flag = (uint8_t) flag;
+    ev->itype = (uint16_t) itype;
+    ev->a = a;
+    ev->b = b;
+    ev->c = c;
+    if (ev == &local)
+        iplc_sim_format_event(sim->out, ev);
+}
+
+// Cache simulator functions
+int iplc_sim_init_cache(iplc_sim_t *sim, cache_t *cache, const char *name,
+                        const iplc_cache_config_t *config, unsigned long max_size);
+void iplc_sim_free_cache(cache_t *cache);
+int iplc_sim_cache_find(const cache_t *cache, unsigned int index, uint32_t tag);
+int iplc_sim_replace_on_miss(cache_t *cache, unsigned int index, uint32_t tag, uint32_t *victim_tag);
+void iplc_sim_update_on_hit(cache_t *cache, unsigned int index, int way);
+int iplc_sim_cache_lookup(cache_t *cache, unsigned int address);
+int iplc_sim_cache_fill(cache_t *cache, unsigned int address, unsigned int *victim);
+int iplc_sim_cache_invalidate(cache_t *cache, unsigned int address);
+void iplc_sim_cache_mark_dirty(cache_t *cache, unsigned int address);
+int iplc_sim_trap_address(iplc_sim_t *sim, cache_t *cache, unsigned int pc, unsigned int address,
+                          unsigned int *latency);
+int iplc_sim_trap_store(iplc_sim_t *sim, unsigned int pc, unsigned int address, unsigned int *latency);
+void iplc_sim_warm_address(iplc_sim_t *sim, cache_t *cache, unsigned int address, int store);
+long iplc_sim_mshr_access(iplc_sim_t *sim, unsigned int address, int hit, unsigned int latency);
+
+// Classification functions
+int iplc_sim_init_classifier(classifier_t *c, int blocks);
+void iplc_sim_free_classifier(classifier_t *c);
+void iplc_sim_classify(classifier_t *c, uint32_t block, int hit);
+
+// Profile functions
+int iplc_sim_init_profile(profile_t *p);
+void iplc_sim_free_profile(profile_t *p);
+iplc_profile_entry_t *iplc_sim_profile_entry(profile_t *p, unsigned int pc);
+
+// Interval functions
+int iplc_sim_init_intervals(iplc_sim_t *sim, const iplc_sim_config_t *config);
+void iplc_sim_end_interval(iplc_sim_t *sim);
+int iplc_sim_flush_intervals(iplc_sim_t *sim);
+void iplc_sim_free_intervals(iplc_sim_t *sim);
+
+// Sampling functions
+int iplc_sim_init_sampling(iplc_sim_t *sim, const iplc_sim_config_t *config);
+void iplc_sim_free_sampling(iplc_sim_t *sim);
+int iplc_sim_sample_step(iplc_sim_t *sim, const trace_record_t *rec);
+void iplc_sim_finish_sampling(iplc_sim_t *sim);
+
+// Prefetch functions
+int iplc_sim_init_prefetcher(prefetcher_t *pf, cache_t *cache, const iplc_prefetch_config_t *config);
+void iplc_sim_free_prefetcher(prefetcher_t *pf);
+
+// Branch prediction functions
+int iplc_sim_init_predictor(branch_predictor_t *bp, const iplc_sim_config_t *config);
+void iplc_sim_free_predictor(branch_predictor_t *bp);
+int iplc_sim_predict(branch_predictor_t *bp, int opcode, unsigned int address, unsigned int next_address);
+
+// Out-of-order core functions
+int iplc_sim_init_ooo(ooo_core_t *ooo, const iplc_sim_config_t *config);
+void iplc_sim_free_ooo(ooo_core_t *ooo);
+void iplc_sim_ooo_fetch(ooo_core_t *ooo, enum instruction_type itype, const hazard_regs_t *regs,
+                        unsigned int latency, int mispredicted);
+void iplc_sim_ooo_memory(ooo_core_t *ooo, unsigned int latency);
+void iplc_sim_ooo_finish(ooo_core_t *ooo);
+
+// Pipeline functions
+void iplc_sim_dump_pipeline(iplc_sim_t *sim);
+void iplc_sim_push_pipeline_stage(iplc_sim_t *sim);
+void iplc_sim_drain_pipeline(iplc_sim_t *sim);
+int iplc_sim_joins_group(iplc_sim_t *sim, int itype, const hazard_regs_t *regs);
+void iplc_sim_process_pipeline_rtype(iplc_sim_t *sim, int dest_reg, int reg1, int reg2_or_constant);
+void iplc_sim_process_pipeline_lw(iplc_sim_t *sim, int dest_reg, int base_reg, unsigned int data_address);
+void iplc_sim_process_pipeline_sw(iplc_sim_t *sim, int src_reg, int base_reg, unsigned int data_address);
+void iplc_sim_process_pipeline_branch(iplc_sim_t *sim, int reg1, int reg2);
+void iplc_sim_process_pipeline_jump(iplc_sim_t *sim);
+void iplc_sim_process_pipeline_syscall(iplc_sim_t *sim);
+void iplc_sim_process_pipeline_nop(iplc_sim_t *sim);
+
+#endif
@@ -0,0 +1,228 @@
+/***********************************************************************/
+/***********************************************************************
+ Pipeline Cache Simulator -- interval statistics and phases
+ ***********************************************************************/
+/***********************************************************************/
+#include "iplc-internal.h"
+
+const char *interval_unit_names[NUM_INTERVAL_UNITS] = {
+    "instructions", "cycles"
+};
+
+/*
+ * Normalized BBVs at most this far apart (in Manhattan distance, which runs
+ * from 0 for the same mix of basic blocks to 2 for none in common) are the
+ * same phase.
+ */
+#define PHASE_THRESHOLD 0.4
+
+/************************************************************************************************/
+/* Interval Functions ***************************************************************************/
+/************************************************************************************************/
+
+/*
+ * Set the sim's interval state up from config.  With interval_out the
+ * header goes out now and intervals are buffered.  Returns -1 if memory
+ * runs out or the header cannot be written.
+ */
+int iplc_sim_init_intervals(iplc_sim_t *sim, const iplc_sim_config_t *config)
+{
+    intervals_t *iv = &sim->intervals;
+    interval_header_t header;
+    int i;
+
+    if (config->interval == 0)
+        return 0;
+
+    iv->length = iv->stats.length = config->interval;
+    iv->unit = iv->stats.unit = config->interval_unit;
+    iv->dims = iv->stats.bbv_dims = config->bbv_dims;
+    iv->out = config->interval_out;
+    iv->binary = config->interval_binary;
+    iv->next = iv->length;
+    if (iv->dims) {
+        iv->bbv = (uint32_t *) calloc(iv->dims, sizeof(uint32_t));
+        iv->phase = (float *) calloc(MAX_PHASES * iv->dims, sizeof(float));
+        if (!iv->bbv || !iv->phase)
+            return -1;
+    }
+    if (iv->out == NULL)
+        return 0;
+
+    iv->ring = (interval_record_t *) malloc(INTERVAL_RING * sizeof(interval_record_t));
+    iv->ring_bbv = (uint32_t *) malloc(INTERVAL_RING * (iv->dims + 1) * sizeof(uint32_t));
+    if (!iv->ring || !iv->ring_bbv)
+        return -1;
+
+    if (iv->binary) {
+        bzero(&header, sizeof(header));
+        memcpy(header.magic, INTERVAL_MAGIC, sizeof(INTERVAL_MAGIC));
+        header.version = INTERVAL_VERSION;
+        header.record_size = sizeof(interval_record_t);
+        header.unit = (uint32_t) iv->unit;
+        header.length = (uint32_t) iv->length;
+        header.bbv_dims = (uint32_t) iv->dims;
+        if (fwrite(&header, sizeof(header), 1, iv->out) != 1)
+            return -1;
+        return 0;
+    }
+    fprintf(iv->out, "interval,phase,instructions,cycles,cpi,icache_accesses,icache_misses,icache_miss_rate,"
+            "dcache_accesses,dcache_misses,dcache_miss_rate,branches,branch_accuracy");
+    for (i = 0; i < iv->dims; i++)
+        fprintf(iv->out, ",bbv_%d", i);
+    fprintf(iv->out, "\n");
+    return ferror(iv->out) ? -1 : 0;
+}
+
+/*
+ * Counter totals so far, cut to 32 bits: the deltas come out right anyway.
+ */
+static void interval_totals(const iplc_sim_t *sim, interval_record_t *t)
+{
+    t->instructions = (uint32_t) sim->instruction_count;
+    t->cycles = (uint32_t) sim->pipeline_cycles;
+    t->icache_accesses = (uint32_t) sim->icache.access;
+    t->icache_misses = (uint32_t) sim->icache.miss;
+    t->dcache_accesses = (uint32_t) sim->dcache.access;
+    t->dcache_misses = (uint32_t) sim->dcache.miss;
+    t->branches = (uint32_t) sim->branch_count;
+    t->correct_branches = (uint32_t) sim->correct_branch_predictions;
+}
+
+/*
+ * The phase of the open interval's BBV: the nearest one seen so far if it
+ * is within PHASE_THRESHOLD, otherwise a new one while there is room for
+ * it.  -1 for an interval that fetched nothing.
+ */
+static int interval_phase(intervals_t *iv)
+{
+    float v[MAX_BBV_DIMS], *signature, distance, best_distance = 0.0f;
+    uint64_t total = 0;
+    int i, p, best = -1;
+
+    for (i = 0; i < iv->dims; i++)
+        total += iv->bbv[i];
+    if (total == 0)
+        return -1;
+    for (i = 0; i < iv->dims; i++)
+        v[i] = (float) iv->bbv[i] / (float) total;
+
+    for (p = 0; p < iv->stats.phases; p++) {
+        signature = &iv->phase[p * iv->dims];
+        distance = 0.0f;
+        for (i = 0; i < iv->dims; i++)
+            distance += fabsf(v[i] - signature[i]);
+        if (best < 0 || distance < best_distance) {
+            best = p;
+            best_distance = distance;
+        }
+    }
+    if ((best < 0 || best_distance > PHASE_THRESHOLD) && iv->stats.phases < MAX_PHASES) {
+        best = iv->stats.phases++;
+        memcpy(&iv->phase[best * iv->dims], v, iv->dims * sizeof(float));
+    }
+    return best;
+}
+
+/*
+ * Close the open interval: its counter deltas and phase go into the ring,
+ * which is written out once full, and the next one starts where the unit
+ * count next reaches a multiple of the length.  Nothing is recorded for an
+ * interval that saw neither an instruction nor a cycle.
+ */
+void iplc_sim_end_interval(iplc_sim_t *sim)
+{
+    intervals_t *iv = &sim->intervals;
+    interval_record_t now, rec;
+    long current;
+    double cpi;
+
+    interval_totals(sim, &now);
+    current = iv->unit == INTERVAL_CYCLES ? sim->pipeline_cycles : sim->instruction_count;
+    while (iv->next <= current)
+        iv->next += iv->length;
+    if (now.instructions == iv->start.instructions && now.cycles == iv->start.cycles)
+        return;
+
+    rec.index = (uint32_t) iv->stats.intervals;
+    rec.phase = iv->dims ? interval_phase(iv) : -1;
+    rec.instructions = now.instructions - iv->start.instructions;
+    rec.cycles = now.cycles - iv->start.cycles;
+    rec.icache_accesses = now.icache_accesses - iv->start.icache_accesses;
+    rec.icache_misses = now.icache_misses - iv->start.icache_misses;
+    rec.dcache_accesses = now.dcache_accesses - iv->start.dcache_accesses;
+    rec.dcache_misses = now.dcache_misses - iv->start.dcache_misses;
+    rec.branches = now.branches - iv->start.branches;
+    rec.correct_branches = now.correct_branches - iv->start.correct_branches;
+    iv->start = now;
+
+    if (rec.instructions) {
+        cpi = (double) rec.cycles / (double) rec.instructions;
+        if (iv->stats.intervals == 0 || cpi < iv->stats.min_cpi)
+            iv->stats.min_cpi = cpi;
+        if (iv->stats.intervals == 0 || cpi > iv->stats.max_cpi)
+            iv->stats.max_cpi = cpi;
+    }
+    iv->stats.intervals++;
+
+    if (iv->ring) {
+        iv->ring[iv->ring_count] = rec;
+        if (iv->dims)
+            memcpy(&iv->ring_bbv[iv->ring_count * iv->dims], iv->bbv, iv->dims * sizeof(uint32_t));
+        if (++iv->ring_count == INTERVAL_RING)
+            iplc_sim_flush_intervals(sim);
+    }
+    if (iv->dims)
+        bzero(iv->bbv, iv->dims * sizeof(uint32_t));
+}
+
+static double interval_ratio(uint32_t part, uint32_t whole)
+{
+    return whole ? (double) part / (double) whole : 0.0;
+}
+
+/*
+ * Write out the intervals waiting in the ring.  Returns -1 if the write
+ * fails.
+ */
+int iplc_sim_flush_intervals(iplc_sim_t *sim)
+{
+    intervals_t *iv = &sim->intervals;
+    const interval_record_t *rec;
+    const uint32_t *bbv;
+    int count = iv->ring_count, n, i;
+
+    iv->ring_count = 0;
+    for (n = 0; n < count; n++) {
+        rec = &iv->ring[n];
+        bbv = &iv->ring_bbv[n * iv->dims];
+        if (iv->binary) {
+            if (fwrite(rec, sizeof(interval_record_t), 1, iv->out) != 1 ||
+                (iv->dims && fwrite(bbv, sizeof(uint32_t), iv->dims, iv->out) != (size_t) iv->dims))
+                break;
+            continue;
+        }
+        fprintf(iv->out, "%u,%d,%u,%u,%f,%u,%u,%f,%u,%u,%f,%u,%f", rec->index, rec->phase,
+                rec->instructions, rec->cycles, interval_ratio(rec->cycles, rec->instructions),
+                rec->icache_accesses, rec->icache_misses, interval_ratio(rec->icache_misses, rec->icache_accesses),
+                rec->dcache_accesses, rec->dcache_misses, interval_ratio(rec->dcache_misses, rec->dcache_accesses),
+                rec->branches, interval_ratio(rec->correct_branches, rec->branches));
+        for (i = 0; i < iv->dims; i++)
+            fprintf(iv->out, ",%u", bbv[i]);
+        fprintf(iv->out, "\n");
+    }
+    return n < count || ferror(iv->out) ? -1 : 0;
+}
+
+void iplc_sim_free_intervals(iplc_sim_t *sim)
+{
+    intervals_t *iv = &sim->intervals;
+
+    if (iv->ring)
+        iplc_sim_flush_intervals(sim);
+    free(iv->bbv);
+    free(iv->ring);
+    free(iv->ring_bbv);
+    free(iv->phase);
+    bzero(iv, sizeof(intervals_t));
+}
@@ -0,0 +1,300 @@
+/***********************************************************************/
+/***********************************************************************
+ Pipeline Cache Simulator -- out-of-order core
+ ***********************************************************************/
+/***********************************************************************/
+#include "iplc-internal.h"
+
+/************************************************************************************************/
+/* Out-of-Order Functions ***********************************************************************/
+/************************************************************************************************/
+
+/*
+ * Size the core for config and carve its rings, heap and calendar out of
+ * one allocation.  Nothing is allocated without a ROB.  Returns -1 if
+ * memory runs out.
+ */
+int iplc_sim_init_ooo(ooo_core_t *ooo, const iplc_sim_config_t *config)
+{
+    size_t longs;
+
+    bzero(ooo, sizeof(ooo_core_t));
+    if (config->rob_entries == 0)
+        return 0;
+
+    ooo->rob_entries = config->rob_entries;
+    ooo->iq_entries = config->iq_entries ? config->iq_entries : (config->rob_entries + 1) / 2;
+    ooo->lsq_entries = config->lsq_entries ? config->lsq_entries : (config->rob_entries + 1) / 2;
+    ooo->width = config->issue_width;
+    ooo->front_depth = config->pipeline_depth - 3;
+
+    longs = ooo->rob_entries + ooo->lsq_entries + ooo->iq_entries + OOO_CALENDAR;
+    ooo->store_size = longs * sizeof(long) + 2 * OOO_CALENDAR;
+    ooo->store = malloc(ooo->store_size);
+    if (ooo->store == NULL)
+        return -1;
+    ooo->rob_commit = (long *) ooo->store;
+    ooo->lsq_commit = ooo->rob_commit + ooo->rob_entries;
+    ooo->iq_heap = ooo->lsq_commit + ooo->lsq_entries;
+    ooo->calendar_cycle = ooo->iq_heap + ooo->iq_entries;
+    ooo->calendar_issue = (uint8_t *) (ooo->calendar_cycle + OOO_CALENDAR);
+    ooo->calendar_mem = ooo->calendar_issue + OOO_CALENDAR;
+    memset(ooo->calendar_cycle, 0xff, OOO_CALENDAR * sizeof(long));
+
+    ooo->stats.rob_entries = ooo->rob_entries;
+    ooo->stats.iq_entries = ooo->iq_entries;
+    ooo->stats.lsq_entries = ooo->lsq_entries;
+    return 0;
+}
+
+void iplc_sim_free_ooo(ooo_core_t *ooo)
+{
+    free(ooo->store);
+    bzero(ooo, sizeof(ooo_core_t));
+}
+
+static long max_cycle(long a, long b)
+{
+    return a > b ? a : b;
+}
+
+static void iq_push(ooo_core_t *ooo, long issue)
+{
+    int i = ooo->iq_size++, parent;
+
+    while (i > 0 && ooo->iq_heap[parent = (i - 1) / 2] > issue) {
+        ooo->iq_heap[i] = ooo->iq_heap[parent];
+        i = parent;
+    }
+    ooo->iq_heap[i] = issue;
+}
+
+static long iq_pop(ooo_core_t *ooo)
+{
+    long top = ooo->iq_heap[0], last = ooo->iq_heap[--ooo->iq_size];
+    int i = 0, child;
+
+    while ((child = 2 * i + 1) < ooo->iq_size) {
+        if (child + 1 < ooo->iq_size && ooo->iq_heap[child + 1] < ooo->iq_heap[child])
+            child++;
+        if (last <= ooo->iq_heap[child])
+            break;
+        ooo->iq_heap[i] = ooo->iq_heap[child];
+        i = child;
+    }
+    ooo->iq_heap[i] = last;
+    return top;
+}
+
+/*
+ * The first cycle from ready on with an issue slot free, and the D-cache
+ * port too for a lw or sw, which it then takes.
+ */
+static long iplc_sim_ooo_issue_slot(ooo_core_t *ooo, long ready, int memory)
+{
+    long cycle;
+    int slot;
+
+    for (cycle = ready; ; cycle++) {
+        slot = cycle & (OOO_CALENDAR - 1);
+        if (ooo->calendar_cycle[slot] != cycle) {
+            ooo->calendar_cycle[slot] = cycle;
+            ooo->calendar_issue[slot] = 0;
+            ooo->calendar_mem[slot] = 0;
+        }
+        if (ooo->calendar_issue[slot] < ooo->width && !(memory && ooo->calendar_mem[slot]))
+            break;
+    }
+    ooo->calendar_issue[slot]++;
+    if (memory)
+        ooo->calendar_mem[slot] = 1;
+    return cycle;
+}
+
+/*
+ * Place one instruction, in program order.  Fetch is in order, width wide
+ * and blocks on I-cache misses and mispredicts, and runs at most
+ * front_depth cycles ahead of dispatch.  Dispatch waits for a ROB entry,
+ * an issue queue entry and, for a lw or sw, a load/store queue entry.
+ * Issue waits for the operands.  A lw completes once the D-cache answers,
+ * a sw goes to a store buffer, and commit is in order and width wide.
+ */
+static void iplc_sim_ooo_time(ooo_core_t *ooo, const ooo_entry_t *entry)
+{
+    int memory = entry->itype == LW || entry->itype == SW;
+    long base, rob = 0, lsq = 0, iq = 0, dispatch, issue, complete, commit;
+    int i;
+
+    /* Fetch */
+    if (ooo->fetch_slots == ooo->width) {
+        ooo->fetch_cycle++;
+        ooo->fetch_slots = 0;
+    }
+    if (ooo->redirect > ooo->fetch_cycle) {
+        ooo->stats.fetch_stall_cycles += ooo->redirect - ooo->fetch_cycle;
+        ooo->fetch_cycle = ooo->redirect;
+        ooo->fetch_slots = 0;
+    }
+    if (entry->fetch_latency > 1) {
+        if (ooo->fetch_slots)
+            ooo->fetch_cycle++;
+        ooo->fetch_cycle += entry->fetch_latency - 1;
+        ooo->fetch_slots = 0;
+        ooo->stats.fetch_stall_cycles += entry->fetch_latency - 1;
+    }
+    if (ooo->dispatch_cycle - ooo->front_depth > ooo->fetch_cycle) {
+        ooo->fetch_cycle = ooo->dispatch_cycle - ooo->front_depth;
+        ooo->fetch_slots = 0;
+    }
+    ooo->fetch_slots++;
+
+    /* Dispatch, naming the first structure that held it up */
+    if (ooo->dispatch_slots == ooo->width) {
+        ooo->dispatch_cycle++;
+        ooo->dispatch_slots = 0;
+    }
+    base = max_cycle(ooo->fetch_cycle + ooo->front_depth, ooo->dispatch_cycle);
+    if (ooo->count >= ooo->rob_entries)
+        rob = ooo->rob_commit[ooo->count % ooo->rob_entries] + 1;
+    if (memory && ooo->mem_count >= ooo->lsq_entries)
+        lsq = ooo->lsq_commit[ooo->mem_count % ooo->lsq_entries] + 1;
+    dispatch = max_cycle(base, max_cycle(rob, lsq));
+    while (ooo->iq_size && ooo->iq_heap[0] < dispatch)
+        iq_pop(ooo);
+    if (ooo->iq_size == ooo->iq_entries) {
+        iq = iq_pop(ooo) + 1;
+        while (ooo->iq_size && ooo->iq_heap[0] < iq)
+            iq_pop(ooo);
+    }
+    dispatch = max_cycle(dispatch, iq);
+    if (dispatch > base) {
+        if (dispatch == rob)
+            ooo->stats.rob_full_cycles += dispatch - base;
+        else if (dispatch == lsq)
+            ooo->stats.lsq_full_cycles += dispatch - base;
+        else
+            ooo->stats.iq_full_cycles += dispatch - base;
+    }
+    if (dispatch > ooo->dispatch_cycle) {
+        ooo->dispatch_cycle = dispatch;
+        ooo->dispatch_slots = 0;
+    }
+    ooo->dispatch_slots++;
+
+    /* Issue and complete */
+    issue = dispatch + 1;
+    for (i = 0; i < 2; i++)
+        if (entry->regs.src[i] > 0 && entry->regs.src[i] < 32)
+            issue = max_cycle(issue, ooo->reg_ready[entry->regs.src[i]]);
+    issue = iplc_sim_ooo_issue_slot(ooo, issue, memory);
+    iq_push(ooo, issue);
+
+    complete = issue + 1;
+    if (entry->itype == LW)
+        complete += entry->mem_latency;
+    if (entry->itype == SW && entry->regs.late_src > 0 && entry->regs.late_src < 32)
+        complete = max_cycle(complete, ooo->reg_ready[entry->regs.late_src]);
+    if (entry->itype != SW && entry->regs.dest > 0 && entry->regs.dest < 32)
+        ooo->reg_ready[entry->regs.dest] = complete;
+    if (entry->mispredicted)
+        ooo->redirect = complete + 1;
+    ooo->last_complete = complete;
+
+    /* Commit */
+    if (ooo->commit_slots == ooo->width) {
+        ooo->commit_cycle++;
+        ooo->commit_slots = 0;
+    }
+    commit = max_cycle(complete + 1, ooo->commit_cycle);
+    if (commit > ooo->commit_cycle) {
+        ooo->commit_cycle = commit;
+        ooo->commit_slots = 0;
+    }
+    ooo->commit_slots++;
+
+    ooo->rob_commit[ooo->count % ooo->rob_entries] = commit;
+    if (memory)
+        ooo->lsq_commit[ooo->mem_count++ % ooo->lsq_entries] = commit;
+    ooo->count++;
+    ooo->stats.instructions++;
+    ooo->stats.rob_occupancy += commit - dispatch;
+    ooo->stats.cycles = commit + 1;
+}
+
+/*
+ * Time everything at the head of the queue that can be: in order, up to
+ * the first lw or sw still waiting on the D-cache, or all of it at the end.
+ */
+static void iplc_sim_ooo_drain(ooo_core_t *ooo, int finish)
+{
+    ooo_entry_t *entry;
+
+    while (ooo->head != ooo->tail) {
+        entry = &ooo->queue[ooo->head & (OOO_QUEUE - 1)];
+        if (entry->mem_latency < 0) {
+            if (!finish)
+                break;
+            entry->mem_latency = 1;
+        }
+        iplc_sim_ooo_time(ooo, entry);
+        ooo->head++;
+    }
+}
+
+/*
+ * Hand the core the next fetch.  mispredicted is the outcome for the
+ * instruction fetched before this one, only known now.
+ */
+void iplc_sim_ooo_fetch(ooo_core_t *ooo, enum instruction_type itype, const hazard_regs_t *regs,
+                        unsigned int latency, int mispredicted)
+{
+    ooo_entry_t *entry;
+
+    if (mispredicted) {
+        if (ooo->head != ooo->tail)
+            ooo->queue[(ooo->tail - 1) & (OOO_QUEUE - 1)].mispredicted = mispredicted;
+        else
+            ooo->redirect = ooo->last_complete + 1;
+    }
+
+    // the pipeline never holds a queue's worth, but never overwrite
+    if (ooo->tail - ooo->head == OOO_QUEUE)
+        iplc_sim_ooo_drain(ooo, 1);
+
+    entry = &ooo->queue[ooo->tail++ & (OOO_QUEUE - 1)];
+    entry->itype = itype;
+    entry->regs = *regs;
+    entry->fetch_latency = latency;
+    entry->mispredicted = MISPREDICT_NONE;
+    entry->mem_latency = (itype == LW || itype == SW) ? -1 : 0;
+    iplc_sim_ooo_drain(ooo, 0);
+}
+
+/*
+ * The pipeline's MEM stage has the D-cache latency of the oldest lw or sw
+ * the core is waiting on; both see them in program order.
+ */
+void iplc_sim_ooo_memory(ooo_core_t *ooo, unsigned int latency)
+{
+    ooo_entry_t *entry;
+
+    if (ooo->mem_next - ooo->head > ooo->tail - ooo->head)
+        ooo->mem_next = ooo->head;
+    for (; ooo->mem_next != ooo->tail; ooo->mem_next++) {
+        entry = &ooo->queue[ooo->mem_next & (OOO_QUEUE - 1)];
+        if (entry->mem_latency < 0) {
+            entry->mem_latency = latency;
+            ooo->mem_next++;
+            break;
+        }
+    }
+    iplc_sim_ooo_drain(ooo, 0);
+}
+
+/*
+ * Time whatever is left once the pipeline has drained.
+ */
+void iplc_sim_ooo_finish(ooo_core_t *ooo)
+{
+    iplc_sim_ooo_drain(ooo, 1);
+}
@@ -0,0 +1,281 @@
+/***********************************************************************/
+/***********************************************************************
+ Pipeline Cache Simulator -- configuration options
+ ***********************************************************************/
+/***********************************************************************/
+#include "iplc-internal.h"
+
+/************************************************************************************************/
+/* Option Functions *****************************************************************************/
+/************************************************************************************************/
+
+/*
+ * Parse an "index,blocksize,assoc[,policy[,latency[,inclusion]]]" cache
+ * option; what is left out keeps its current value.  Returns -1 if it is
+ * malformed, otherwise whether a policy was given.
+ */
+int iplc_sim_parse_cache_option(const char *arg, iplc_cache_config_t *cache)
+{
+    char policy[32], inclusion[32];
+    int fields;
+
+    fields = sscanf(arg, "%d,%d,%d,%31[^,],%d,%31s", &cache->index, &cache->blocksize, &cache->assoc,
+                    policy, &cache->latency, inclusion);
+    if (fields < 3)
+        return -1;
+    if (fields >= 4 && (cache->policy = iplc_sim_policy_by_name(policy)) < 0)
+        return -1;
+    if (fields == 6 && (cache->inclusion = iplc_sim_inclusion_by_name(inclusion)) < 0)
+        return -1;
+    return fields >= 4;
+}
+
+/*
+ * Parse a "predictor[,table_bits[,history_bits[,chooser_bits]]]" branch
+ * predictor option.  Returns -1 if it is malformed.
+ */
+int iplc_sim_parse_predictor_option(const char *arg, iplc_sim_config_t *config)
+{
+    char name[32];
+    int fields;
+
+    fields = sscanf(arg, "%31[^,],%d,%d,%d", name, &config->bp_table_bits, &config->bp_history_bits,
+                    &config->bp_chooser_bits);
+    if (fields < 1 || (config->predictor = iplc_sim_predictor_by_name(name)) < 0)
+        return -1;
+    return 0;
+}
+
+/*
+ * Parse a "depth[,width]" pipeline option.  Returns -1 if it is malformed.
+ */
+int iplc_sim_parse_pipeline_option(const char *arg, iplc_sim_config_t *config)
+{
+    if (sscanf(arg, "%d,%d", &config->pipeline_depth, &config->issue_width) < 1)
+        return -1;
+    return 0;
+}
+
+/*
+ * Parse a "rob[,iq[,lsq]]" out-of-order core option.  Returns -1 if it is
+ * malformed.
+ */
+int iplc_sim_parse_ooo_option(const char *arg, iplc_sim_config_t *config)
+{
+    if (sscanf(arg, "%d,%d,%d", &config->rob_entries, &config->iq_entries, &config->lsq_entries) < 1)
+        return -1;
+    return 0;
+}
+
+/*
+ * Parse a "policy[,allocate|noallocate[,buffer]]" write policy option.
+ * Returns -1 if it is malformed.
+ */
+int iplc_sim_parse_write_option(const char *arg, iplc_sim_config_t *config)
+{
+    char policy[32], allocate[32];
+    int fields;
+
+    fields = sscanf(arg, "%31[^,],%31[^,],%d", policy, allocate, &config->write_buffer);
+    if (fields < 1 || (config->write_policy = iplc_sim_write_policy_by_name(policy)) < 0)
+        return -1;
+    if (fields >= 2) {
+        if (strcmp(allocate, "allocate") == 0)
+            config->write_allocate = 1;
+        else if (strcmp(allocate, "noallocate") == 0)
+            config->write_allocate = 0;
+        else
+            return -1;
+    }
+    return 0;
+}
+
+/*
+ * Parse a "cache,prefetcher[,degree[,entries]]" prefetch option, where
+ * cache is i, d or id for both L1 caches.  Returns -1 if it is malformed.
+ */
+int iplc_sim_parse_prefetch_option(const char *arg, iplc_sim_config_t *config)
+{
+    iplc_prefetch_config_t pf;
+    char cache[8], name[32];
+    int fields;
+
+    pf = config->icache_prefetch;
+    fields = sscanf(arg, "%7[^,],%31[^,],%d,%d", cache, name, &pf.degree, &pf.entries);
+    if (fields < 2 || (pf.type = iplc_sim_prefetcher_by_name(name)) < 0)
+        return -1;
+    if (strcmp(cache, "i") == 0)
+        config->icache_prefetch = pf;
+    else if (strcmp(cache, "d") == 0)
+        config->dcache_prefetch = pf;
+    else if (strcmp(cache, "id") == 0)
+        config->icache_prefetch = config->dcache_prefetch = pf;
+    else
+        return -1;
+    return 0;
+}
+
+/*
+ * Parse a "length[,instructions|cycles[,bbv_dims]]" interval option.
+ * Returns -1 if it is malformed.
+ */
+int iplc_sim_parse_interval_option(const char *arg, iplc_sim_config_t *config)
+{
+    char unit[32];
+    int fields, i;
+
+    fields = sscanf(arg, "%d,%31[^,],%d", &config->interval, unit, &config->bbv_dims);
+    if (fields < 1 || config->interval < 1)
+        return -1;
+    if (fields >= 2) {
+        for (i = 0; i < NUM_INTERVAL_UNITS; i++)
+            if (strcmp(unit, interval_unit_names[i]) == 0)
+                break;
+        if (i == NUM_INTERVAL_UNITS)
+            return -1;
+        config->interval_unit = i;
+    }
+    return 0;
+}
+
+/*
+ * Parse a "window[,warmup[,period]]" sampling option.  Returns -1 if it is
+ * malformed.
+ */
+int iplc_sim_parse_sample_option(const char *arg, iplc_sim_config_t *config)
+{
+    if (sscanf(arg, "%ld,%ld,%ld", &config->sample_window, &config->sample_warmup, &config->sample_period) < 1 ||
+        config->sample_window < 1)
+        return -1;
+    return 0;
+}
+
+/*
+ * Apply a line of "-option value" pairs on top of config, the same options
+ * iplc-sim takes for a single run:
+ *   -L cache  both L1 caches      -I cache  I-cache      -D cache  D-cache
+ *   -2 cache  L2                  -3 cache  L3           -m cycles memory latency
+ *   -p policy every cache without its own policy         -r seed
+ *   -b predictor[,table[,history[,chooser]]]             -t 0|1    static direction
+ *   -B btb_entries                -R ras_depth           -H off|stall|forward
+ *   -P depth[,width]  pipeline stages and issue width    -O rob[,iq[,lsq]]  out-of-order core
+ *   -M mshrs  non-blocking D-cache       -W off|back|through[,allocate|noallocate[,buffer]]
+ *   -F i|d|id,none|next|stride|stream[,degree[,entries]]  L1 prefetchers
+ *   -C 0|1    classify misses as compulsory, capacity or conflict
+ *   -i length[,instructions|cycles[,bbv_dims]]  interval statistics
+ *   -S window[,warmup[,period]]  sampled simulation
+ * Returns -1 on an unknown option, a missing value or a bad value; the
+ * result still has to pass iplc_sim_config_error().
+ */
+int iplc_sim_parse_options(iplc_sim_config_t *config, const char *line)
+{
+    char copy[512], *save = NULL, *option, *value;
+    int policy = -1, given, policy_given[4] = {0, 0, 0, 0};
+
+    if (strlen(line) >= sizeof(copy))
+        return -1;
+    strcpy(copy, line);
+
+    for (option = strtok_r(copy, " \t\r\n", &save); option; option = strtok_r(NULL, " \t\r\n", &save)) {
+        value = strtok_r(NULL, " \t\r\n", &save);
+        if (option[0] != '-' || option[1] == '\0' || option[2] != '\0' || value == NULL)
+            return -1;
+
+        switch (option[1]) {
+            case 'L':
+                given = iplc_sim_parse_cache_option(value, &config->icache);
+                if (given < 0)
+                    return -1;
+                config->dcache = config->icache;
+                policy_given[0] = policy_given[1] = given;
+                break;
+            case 'I':
+            case 'D':
+            case '2':
+            case '3':
+                given = iplc_sim_parse_cache_option(value, option[1] == 'I' ? &config->icache :
+                                                           option[1] == 'D' ? &config->dcache :
+                                                           option[1] == '2' ? &config->l2 : &config->l3);
+                if (given < 0)
+                    return -1;
+                policy_given[option[1] == 'I' ? 0 : option[1] == 'D' ? 1 : option[1] == '2' ? 2 : 3] = given;
+                if (option[1] == '2' && config->levels < 2)
+                    config->levels = 2;
+                if (option[1] == '3')
+                    config->levels = 3;
+                break;
+            case 'm':
+                config->memory_latency = atoi(value);
+                break;
+            case 'p':
+                if ((policy = iplc_sim_policy_by_name(value)) < 0)
+                    return -1;
+                break;
+            case 'r':
+                config->seed = (unsigned int) strtoul(value, NULL, 0);
+                break;
+            case 'b':
+                if (iplc_sim_parse_predictor_option(value, config) < 0)
+                    return -1;
+                break;
+            case 't':
+                config->branch_predict_taken = (unsigned int) atoi(value);
+                break;
+            case 'B':
+                config->btb_entries = atoi(value);
+                break;
+            case 'R':
+                config->ras_depth = atoi(value);
+                break;
+            case 'H':
+                if ((config->hazards = iplc_sim_hazards_by_name(value)) < 0)
+                    return -1;
+                break;
+            case 'P':
+                if (iplc_sim_parse_pipeline_option(value, config) < 0)
+                    return -1;
+                break;
+            case 'O':
+                if (iplc_sim_parse_ooo_option(value, config) < 0)
+                    return -1;
+                break;
+            case 'M':
+                config->mshrs = atoi(value);
+                break;
+            case 'W':
+                if (iplc_sim_parse_write_option(value, config) < 0)
+                    return -1;
+                break;
+            case 'F':
+                if (iplc_sim_parse_prefetch_option(value, config) < 0)
+                    return -1;
+                break;
+            case 'C':
+                config->classify_misses = (unsigned int) atoi(value);
+                break;
+            case 'i':
+                if (iplc_sim_parse_interval_option(value, config) < 0)
+                    return -1;
+                break;
+            case 'S':
+                if (iplc_sim_parse_sample_option(value, config) < 0)
+                    return -1;
+                break;
+            default:
+                return -1;
+        }
+    }
+
+    // like the command line, -p only covers caches that did not name a policy
+    if (policy >= 0) {
+        if (!policy_given[0])
+            config->icache.policy = policy;
+        if (!policy_given[1])
+            config->dcache.policy = policy;
+        if (!policy_given[2])
+            config->l2.policy = policy;
+        if (!policy_given[3])
+            config->l3.policy = policy;
+    }
+    return 0;
+}
@@ -0,0 +1,261 @@
+/***********************************************************************/
+/***********************************************************************
+ Pipeline Cache Simulator -- set-partitioned cache-only simulation
+ ***********************************************************************/
+/***********************************************************************/
+#include <pthread.h>
+#include <sched.h>
+
+#include "iplc-internal.h"
+
+/************************************************************************************************/
+/* Partition Functions **************************************************************************/
+/************************************************************************************************/
+
+/*
+ * Cache-only simulation has every access go through iplc_sim_warm_address()
+ * and nothing else.  An access only ever touches one set per level, and a
+ * victim shares its set with the access that evicted it, so address bits
+ * that lie in the set index of every cache split the sets of all of them
+ * into partitions no access crosses.  Each partition gets its own
+ * simulator on its own thread and sees its accesses in trace order, which
+ * leaves every set exactly as the serial run would.
+ */
+#define PARTITION_RING 65536        // accesses queued per worker, power of two
+#define PARTITION_BATCH 1024        // published to the worker this many at a time
+#define MAX_PARTITION_BITS 8
+
+enum partition_access {ACCESS_FETCH, ACCESS_LOAD, ACCESS_STORE};
+
+/*
+ * Single producer, single consumer ring of address << 2 | enum
+ * partition_access.  head and tail only grow and sit on lines of their own.
+ */
+typedef struct partition_ring
+{
+    uint64_t      *slot;
+    unsigned long tail;             // written by the reader
+    char          pad[64 - sizeof(unsigned long)];
+    unsigned long head;             // written by the worker
+    char          pad2[64 - sizeof(unsigned long)];
+    int           done;             // no more accesses after tail
+} partition_ring_t;
+
+typedef struct partition
+{
+    iplc_sim_t    *sim;
+    partition_ring_t ring;
+    unsigned long tail;             // reader's own, ahead of ring.tail
+    unsigned long head;             // reader's last look at ring.head
+    int           started;
+    pthread_t     thread;
+} partition_t;
+
+static void partition_access(iplc_sim_t *sim, uint64_t access)
+{
+    unsigned int address = (unsigned int) (access >> 2);
+    int kind = (int) (access & 3);
+
+    iplc_sim_warm_address(sim, kind == ACCESS_FETCH ? &sim->icache : &sim->dcache, address, kind == ACCESS_STORE);
+}
+
+static void *partition_worker(void *arg)
+{
+    partition_t *part = (partition_t *) arg;
+    partition_ring_t *ring = &part->ring;
+    unsigned long head = 0, tail;
+
+    for (;;) {
+        tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+        if (head == tail) {
+            // done is set after the last tail, so check for stragglers once more
+            if (__atomic_load_n(&ring->done, __ATOMIC_ACQUIRE) &&
+                head == __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE))
+                break;
+            sched_yield();
+            continue;
+        }
+        for (; head != tail; head++)
+            partition_access(part->sim, ring->slot[head & (PARTITION_RING - 1)]);
+        __atomic_store_n(&ring->head, head, __ATOMIC_RELEASE);
+    }
+    return NULL;
+}
+
+static void partition_publish(partition_t *part)
+{
+    __atomic_store_n(&part->ring.tail, part->tail, __ATOMIC_RELEASE);
+}
+
+/*
+ * Queue one access for part's worker, waiting while its ring is full.
+ */
+static void partition_push(partition_t *part, uint64_t access)
+{
+    while (part->tail - part->head == PARTITION_RING) {
+        partition_publish(part);
+        part->head = __atomic_load_n(&part->ring.head, __ATOMIC_ACQUIRE);
+        if (part->tail - part->head == PARTITION_RING)
+            sched_yield();
+    }
+    part->ring.slot[part->tail++ & (PARTITION_RING - 1)] = access;
+    if ((part->tail & (PARTITION_BATCH - 1)) == 0)
+        partition_publish(part);
+}
+
+/*
+ * How many address bits, from *shift up, lie in the set index of every
+ * configured cache.  0 when the run has to stay serial: random and BRRIP
+ * replacement draw from one random stream per cache, and the 3C shadow is
+ * fully associative, so both depend on the order across sets.
+ */
+static int partition_bits(const iplc_sim_t *sim, int *shift)
+{
+    const cache_t *caches[4] = {&sim->icache, &sim->dcache, &sim->l2, &sim->l3};
+    int low = 0, high = 32, i, policy;
+
+    for (i = 0; i < 2 + sim->num_lower; i++) {
+        policy = (int) (caches[i]->policy - cache_policies);
+        if (policy == POLICY_RANDOM || policy == POLICY_BRRIP || caches[i]->classifier)
+            return 0;
+        if (caches[i]->blockoffsetbits > low)
+            low = caches[i]->blockoffsetbits;
+        if (caches[i]->tag_shift < high)
+            high = caches[i]->tag_shift;
+    }
+    *shift = low;
+    if (high - low > MAX_PARTITION_BITS)
+        return MAX_PARTITION_BITS;
+    return high > low ? high - low : 0;
+}
+
+static void partition_add_cache(iplc_cache_stats_t *stats, const cache_t *cache)
+{
+    stats->access += cache->access;
+    stats->miss += cache->miss;
+    stats->hit += cache->hit;
+}
+
+/*
+ * The statistics of every partition summed, as one serial run would have
+ * them.
+ */
+static void partition_merge(partition_t *parts, int count, iplc_sim_stats_t *stats)
+{
+    int i;
+
+    for (i = 0; i < count; i++) {
+        partition_add_cache(&stats->icache, &parts[i].sim->icache);
+        partition_add_cache(&stats->dcache, &parts[i].sim->dcache);
+        partition_add_cache(&stats->l2, &parts[i].sim->l2);
+        partition_add_cache(&stats->l3, &parts[i].sim->l3);
+        stats->memory_access += parts[i].sim->memory_access;
+    }
+    stats->cache_access = stats->icache.access + stats->dcache.access;
+    stats->cache_miss = stats->icache.miss + stats->dcache.miss;
+    stats->cache_hit = stats->icache.hit + stats->dcache.hit;
+}
+
+/*
+ * Run trace through the caches of config alone, without the pipeline: an
+ * I-cache fetch for every record and a D-cache access for every lw and sw.
+ * The sets are split across up to num_threads workers fed by this thread,
+ * when the caches allow it, and the results match the serial run.  Only
+ * the cache statistics and the instruction count are filled in, with
+ * partitions saying how many workers there were.  Returns -1 if config is
+ * rejected or memory runs out.
+ */
+int iplc_sim_cache_only(const trace_t *trace, const iplc_sim_config_t *config, int num_threads,
+                        iplc_sim_stats_t *stats)
+{
+    iplc_sim_config_t quiet = *config;
+    partition_t *parts = NULL;
+    const trace_record_t *rec;
+    unsigned long r;
+    int shift = 0, bits, count = 1, error = 0, threaded = 0, i;
+    unsigned int mask;
+
+    bzero(stats, sizeof(iplc_sim_stats_t));
+    // nothing but the caches runs, so nothing else is set up
+    quiet.events = 0;
+    quiet.event_out = NULL;
+    quiet.profile = 0;
+    quiet.interval = 0;
+    quiet.bbv_dims = 0;
+    quiet.interval_out = NULL;
+    quiet.sample_window = 0;
+    quiet.num_simpoints = 0;
+    quiet.icache_prefetch.type = PREFETCH_NONE;
+    quiet.dcache_prefetch.type = PREFETCH_NONE;
+    quiet.rob_entries = quiet.iq_entries = quiet.lsq_entries = 0;
+
+    parts = (partition_t *) calloc(1, sizeof(partition_t));
+    if (parts == NULL || (parts[0].sim = iplc_sim_create(&quiet)) == NULL) {
+        free(parts);
+        return -1;
+    }
+    bits = partition_bits(parts[0].sim, &shift);
+    while (count < num_threads && count < (1 << bits))
+        count++;
+    mask = (1U << bits) - 1;
+
+    if (count > 1) {
+        iplc_sim_destroy(parts[0].sim);
+        free(parts);
+        parts = (partition_t *) calloc(count, sizeof(partition_t));
+        error = parts == NULL;
+        for (i = 0; !error && i < count; i++) {
+            parts[i].sim = iplc_sim_create(&quiet);
+            parts[i].ring.slot = (uint64_t *) malloc(PARTITION_RING * sizeof(uint64_t));
+            error = parts[i].sim == NULL || parts[i].ring.slot == NULL;
+        }
+        for (i = 0; !error && i < count; i++) {
+            parts[i].started = pthread_create(&parts[i].thread, NULL, partition_worker, &parts[i]) == 0;
+            if (!parts[i].started)
+                break;
+        }
+        threaded = !error && i == count;
+    }
+
+    if (threaded) {
+        for (r = 0; r < trace->count; r++) {
+            rec = &trace->records[r];
+            partition_push(&parts[((rec->instruction_address >> shift) & mask) % count],
+                           (uint64_t) rec->instruction_address << 2 | ACCESS_FETCH);
+            if (rec->opcode == OP_LW || rec->opcode == OP_SW)
+                partition_push(&parts[((rec->data_address >> shift) & mask) % count],
+                               (uint64_t) rec->data_address << 2 | (rec->opcode == OP_SW ? ACCESS_STORE : ACCESS_LOAD));
+        }
+    }
+    for (i = 0; parts && i < count; i++) {
+        if (parts[i].started) {
+            partition_publish(&parts[i]);
+            __atomic_store_n(&parts[i].ring.done, 1, __ATOMIC_RELEASE);
+            pthread_join(parts[i].thread, NULL);
+        }
+    }
+
+    // serial, or the workers could not all be started and none has had anything yet
+    if (!error && !threaded) {
+        for (r = 0; r < trace->count; r++) {
+            rec = &trace->records[r];
+            partition_access(parts[0].sim, (uint64_t) rec->instruction_address << 2 | ACCESS_FETCH);
+            if (rec->opcode == OP_LW || rec->opcode == OP_SW)
+                partition_access(parts[0].sim, (uint64_t) rec->data_address << 2 |
+                                               (rec->opcode == OP_SW ? ACCESS_STORE : ACCESS_LOAD));
+        }
+    }
+
+    if (!error) {
+        partition_merge(parts, threaded ? count : 1, stats);
+        stats->levels = config->levels;
+        stats->instruction_count = (long) trace->count;
+        stats->partitions = threaded ? count : 1;
+    }
+    for (i = 0; parts && i < count; i++) {
+        iplc_sim_destroy(parts[i].sim);
+        free(parts[i].ring.slot);
+    }
+    free(parts);
+    return error ? -1 : 0;
+}
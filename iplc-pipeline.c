@@ -0,0 +1,1146 @@
+/***********************************************************************/
+/***********************************************************************
+ Pipeline Cache Simulator -- simulator instances and the pipeline model
+ ***********************************************************************/
+/***********************************************************************/
+#include "iplc-internal.h"
+
+const char *hazard_names[NUM_HAZARD_MODELS] = {
+    "off", "stall", "forward"
+};
+
+static const enum instruction_type opcode_itypes[NUM_OPCODES] = {
+    NOP, RTYPE, RTYPE, RTYPE, RTYPE, RTYPE, RTYPE, RTYPE,
+    LW, SW, BRANCH, JUMP, JUMP, JUMP, SYSCALL
+};
+
+/*
+ * Look a hazard model up by its name, -1 if there is no such model.
+ */
+int iplc_sim_hazards_by_name(const char *name)
+{
+    int i;
+    
+    for (i = 0; i < NUM_HAZARD_MODELS; i++)
+        if (strcmp(name, hazard_names[i]) == 0)
+            return i;
+    return -1;
+}
+
+/************************************************************************************************/
+/* Simulator Functions **************************************************************************/
+/************************************************************************************************/
+
+/*
+ * Defaults: 4 set, 2 word block, 2-way LRU instruction and data caches with
+ * single cycle hits straight in front of a 10 cycle memory, static predict
+ * not taken with no BTB or RAS, full forwarding in a five stage single issue
+ * pipeline with a blocking D-cache, stores that cost what loads do and no
+ * out-of-order core, and all per-access output on.  The L2 and L3 settings only matter
+ * once levels is raised.
+ */
+void iplc_sim_config_init(iplc_sim_config_t *config)
+{
+    bzero(config, sizeof(iplc_sim_config_t));
+    config->icache.index = 2;
+    config->icache.blocksize = 2;
+    config->icache.assoc = 2;
+    config->icache.policy = POLICY_LRU;
+    config->icache.latency = 1;
+    config->icache.inclusion = INCLUSION_NINE;
+    config->dcache = config->icache;
+    config->l2.index = 6;
+    config->l2.blocksize = 4;
+    config->l2.assoc = 8;
+    config->l2.policy = POLICY_LRU;
+    config->l2.latency = 4;
+    config->l2.inclusion = INCLUSION_NINE;
+    config->l3.index = 9;
+    config->l3.blocksize = 4;
+    config->l3.assoc = 16;
+    config->l3.policy = POLICY_LRU;
+    config->l3.latency = 8;
+    config->l3.inclusion = INCLUSION_NINE;
+    config->levels = 1;
+    config->memory_latency = 10;
+    config->seed = 1;
+    config->branch_predict_taken = 0;
+    config->predictor = PREDICTOR_STATIC;
+    config->bp_table_bits = 10;
+    config->bp_history_bits = 10;
+    config->bp_chooser_bits = 10;
+    config->btb_entries = 0;
+    config->ras_depth = 0;
+    config->hazards = HAZARDS_FORWARD;
+    config->pipeline_depth = 5;
+    config->issue_width = 1;
+    config->rob_entries = 0;
+    config->iq_entries = 0;
+    config->lsq_entries = 0;
+    config->mshrs = 0;
+    config->write_policy = WRITE_OFF;
+    config->write_allocate = 1;
+    config->write_buffer = 0;
+    config->icache_prefetch.type = PREFETCH_NONE;
+    config->icache_prefetch.degree = 2;
+    config->icache_prefetch.entries = 16;
+    config->dcache_prefetch = config->icache_prefetch;
+    config->classify_misses = 0;
+    config->profile = 0;
+    config->interval = 0;
+    config->interval_unit = INTERVAL_INSTRUCTIONS;
+    config->bbv_dims = 0;
+    config->interval_out = NULL;
+    config->interval_binary = 0;
+    config->sample_window = 0;
+    config->sample_warmup = 0;
+    config->sample_period = 0;
+    config->simpoints = NULL;
+    config->num_simpoints = 0;
+    config->events = iplc_sim_event_level(3);
+    config->out = NULL;
+    config->event_out = NULL;
+    config->scalar_tag_match = 0;
+}
+
+/*
+ * Checks shared by every cache level.
+ */
+static const char *iplc_sim_cache_config_error(const iplc_cache_config_t *cache)
+{
+    if (cache->index < 0 || cache->index > 24 || cache->blocksize < 1 || cache->assoc < 1)
+        return "bad geometry";
+    if (cache->assoc > 255)
+        return "associativity above 255";
+    if (cache->policy < 0 || cache->policy >= NUM_POLICIES)
+        return "unknown replacement policy";
+    if (cache->inclusion < 0 || cache->inclusion >= NUM_INCLUSIONS)
+        return "unknown inclusion policy";
+    if (cache->latency < 1)
+        return "latency below 1 cycle";
+    return NULL;
+}
+
+/*
+ * Checks shared by both L1 prefetchers.
+ */
+static int iplc_sim_prefetch_config_error(const iplc_prefetch_config_t *pf)
+{
+    return pf->type < 0 || pf->type >= NUM_PREFETCHERS || pf->degree < 1 ||
+           pf->degree > MAX_PREFETCH_DEGREE || pf->entries < 1 || pf->entries > 4096 ||
+           (pf->entries & (pf->entries - 1));
+}
+
+/*
+ * Say what is wrong with a configuration, or NULL if iplc_sim_create() can
+ * build it.  Lower levels may not have smaller blocks than the levels above
+ * them, and an exclusive level needs the same block size as everything
+ * above it so that evicted blocks move down whole.
+ */
+const char *iplc_sim_config_error(const iplc_sim_config_t *config)
+{
+    const iplc_cache_config_t *lower[MAX_CACHE_LEVELS - 1] = { &config->l2, &config->l3 };
+    int k;
+    
+    if (iplc_sim_cache_config_error(&config->icache))
+        return "I-Cache has a bad geometry, policy or latency";
+    if (iplc_sim_cache_config_error(&config->dcache))
+        return "D-Cache has a bad geometry, policy or latency";
+    if (iplc_sim_cache_size(config->icache.index, config->icache.blocksize,
+                            config->icache.assoc) > MAX_CACHE_SIZE ||
+        iplc_sim_cache_size(config->dcache.index, config->dcache.blocksize,
+                            config->dcache.assoc) > MAX_CACHE_SIZE)
+        return "Cache too big. Greater than MAX_CACHE_SIZE";
+    if (config->levels < 1 || config->levels > MAX_CACHE_LEVELS)
+        return "Cache levels must be 1 to 3";
+    if (config->memory_latency < 1)
+        return "Memory latency below 1 cycle";
+    if (config->predictor < 0 || config->predictor >= NUM_PREDICTORS)
+        return "Unknown branch predictor";
+    if (config->bp_table_bits < 1 || config->bp_table_bits > 24 ||
+        config->bp_chooser_bits < 1 || config->bp_chooser_bits > 24 ||
+        config->bp_history_bits < 0 || config->bp_history_bits > 30)
+        return "Branch predictor table bits out of range";
+    if (config->btb_entries < 0 || config->btb_entries > (1 << 24) ||
+        (config->btb_entries & (config->btb_entries - 1)))
+        return "BTB entries must be 0 or a power of two";
+    if (config->ras_depth < 0 || config->ras_depth > 4096)
+        return "RAS depth out of range";
+    if (config->hazards < 0 || config->hazards >= NUM_HAZARD_MODELS)
+        return "Unknown hazard model";
+    if (config->pipeline_depth < 5 || config->pipeline_depth > MAX_PIPELINE_DEPTH)
+        return "Pipeline depth must be 5 to 16 stages";
+    if (config->issue_width < 1 || config->issue_width > MAX_ISSUE_WIDTH)
+        return "Issue width must be 1 to 4";
+    if (config->rob_entries < 0 || config->rob_entries > 4096 || config->iq_entries < 0 ||
+        config->iq_entries > config->rob_entries || config->lsq_entries < 0 ||
+        config->lsq_entries > config->rob_entries)
+        return "ROB must be 0 to 4096 entries, and the IQ and LSQ no bigger";
+    if (config->mshrs < 0 || config->mshrs > MAX_MSHRS)
+        return "MSHRs must be 0 to 64";
+    if (config->write_policy < 0 || config->write_policy >= NUM_WRITE_POLICIES)
+        return "Unknown write policy";
+    if (config->write_buffer < 0 || config->write_buffer > MAX_WRITE_BUFFER)
+        return "Write buffer must be 0 to 64 entries";
+    if (config->write_policy == WRITE_OFF && (!config->write_allocate || config->write_buffer))
+        return "No-write-allocate and a write buffer need a write policy";
+    if (iplc_sim_prefetch_config_error(&config->icache_prefetch) ||
+        iplc_sim_prefetch_config_error(&config->dcache_prefetch))
+        return "Prefetchers need a known type, a degree of 1 to 8 and a power of two entries up to 4096";
+    if (config->interval < 0 || config->interval_unit < 0 || config->interval_unit >= NUM_INTERVAL_UNITS)
+        return "Intervals need a length and a known unit";
+    if (config->bbv_dims < 0 || config->bbv_dims > MAX_BBV_DIMS || (config->bbv_dims & (config->bbv_dims - 1)) ||
+        (config->bbv_dims && !config->interval))
+        return "BBV dimensions must be a power of two up to 1024, and need intervals";
+    if (config->sample_window < 0 || config->sample_warmup < 0 || config->sample_period < 0 ||
+        config->num_simpoints < 0 || (config->num_simpoints && config->simpoints == NULL))
+        return "Sampling needs a window, warmup and period of at least 0";
+    if (config->sample_window &&
+        (config->sample_period ? config->num_simpoints || config->sample_period < config->sample_window +
+                                 config->sample_warmup : !config->num_simpoints))
+        return "Sampling needs a period of at least window plus warmup, or simpoints";
+    if (config->sample_window && (config->rob_entries || config->interval))
+        return "Sampling leaves out the out-of-order core and interval statistics";
+    
+    for (k = 0; k < config->levels - 1; k++) {
+        if (iplc_sim_cache_config_error(lower[k]))
+            return k ? "L3 has a bad geometry, policy or latency" : "L2 has a bad geometry, policy or latency";
+        if (lower[k]->blocksize < config->icache.blocksize || lower[k]->blocksize < config->dcache.blocksize ||
+            (k && lower[k]->blocksize < lower[k - 1]->blocksize))
+            return "Lower cache levels cannot have smaller blocks";
+        if (lower[k]->inclusion == INCLUSION_EXCLUSIVE &&
+            (lower[k]->blocksize != config->icache.blocksize || lower[k]->blocksize != config->dcache.blocksize ||
+             (k && lower[k]->blocksize != lower[k - 1]->blocksize)))
+            return "An exclusive level needs the block size of the levels above it";
+    }
+    
+    return NULL;
+}
+
+/*
+ * Build a simulator instance.  Returns NULL if iplc_sim_config_error()
+ * rejects the configuration or memory runs out.
+ */
+iplc_sim_t *iplc_sim_create(const iplc_sim_config_t *config)
+{
+    iplc_sim_t *sim = NULL;
+    
+    // calloc leaves every stage empty and every counter at zero
+    sim = (iplc_sim_t *) calloc(1, sizeof(iplc_sim_t));
+    if (sim == NULL || iplc_sim_config_error(config)) {
+        free(sim);
+        return NULL;
+    }
+    
+    sim->config = *config;
+    sim->out = config->out ? config->out : stdout;
+    sim->branch_predict_taken = config->branch_predict_taken;
+    
+    sim->memory_latency = config->memory_latency;
+    sim->hazards = config->hazards;
+    sim->num_mshrs = config->mshrs;
+    sim->mshr_stats.mshrs = config->mshrs;
+    sim->write_policy = config->write_policy;
+    sim->write_allocate = config->write_allocate;
+    sim->write_buffer = config->write_buffer;
+    sim->write_stats.policy = config->write_policy;
+    sim->write_stats.allocate = config->write_allocate;
+    sim->write_stats.buffer_entries = config->write_buffer;
+    sim->depth = config->pipeline_depth;
+    sim->width = config->issue_width;
+    sim->writeback = sim->depth - 1;
+    sim->mem = sim->depth - 2;
+    sim->alu = sim->depth - 3;
+    sim->decode = sim->depth - 4;
+    
+    if (iplc_sim_init_events(sim, config) < 0 || iplc_sim_init_intervals(sim, config) < 0 ||
+        iplc_sim_init_sampling(sim, config) < 0) {
+        iplc_sim_destroy(sim);
+        return NULL;
+    }
+    if (iplc_sim_init_cache(sim, &sim->icache, "I-Cache", &config->icache, MAX_CACHE_SIZE) < 0 ||
+        iplc_sim_init_cache(sim, &sim->dcache, "D-Cache", &config->dcache, MAX_CACHE_SIZE) < 0 ||
+        (config->levels > 1 && iplc_sim_init_cache(sim, &sim->l2, "L2", &config->l2, 0) < 0) ||
+        (config->levels > 2 && iplc_sim_init_cache(sim, &sim->l3, "L3", &config->l3, 0) < 0)) {
+        iplc_sim_destroy(sim);
+        return NULL;
+    }
+    if (iplc_sim_init_prefetcher(&sim->icache_prefetch, &sim->icache, &config->icache_prefetch) < 0 ||
+        iplc_sim_init_prefetcher(&sim->dcache_prefetch, &sim->dcache, &config->dcache_prefetch) < 0) {
+        iplc_sim_destroy(sim);
+        return NULL;
+    }
+    if (iplc_sim_init_predictor(&sim->bp, config) < 0 || iplc_sim_init_ooo(&sim->ooo, config) < 0 ||
+        (config->profile && iplc_sim_init_profile(&sim->profile) < 0)) {
+        iplc_sim_destroy(sim);
+        return NULL;
+    }
+    if (config->levels > 1)
+        sim->lower[sim->num_lower++] = &sim->l2;
+    if (config->levels > 2)
+        sim->lower[sim->num_lower++] = &sim->l3;
+    
+    return sim;
+}
+
+/*
+ * Fetch a decoded instruction through the I-cache and hand it to the pipeline.
+ * Returns -1 for a record with an unknown opcode.
+ */
+int iplc_sim_step(iplc_sim_t *sim, const trace_record_t *rec)
+{
+    stage_t *fetch = iplc_sim_stage(sim, FETCH);
+    pipeline_t *last = &fetch->slot[fetch->count ? fetch->count - 1 : 0];
+    hazard_regs_t regs;
+    iplc_profile_entry_t *hotspot;
+    int mispredicted = MISPREDICT_NONE;
+    int instruction_hit = 0;
+    unsigned int latency = 0;
+    int i=0;
+    
+    if (rec->opcode >= NUM_OPCODES)
+        return -1;
+    if (sim->sampler.window && iplc_sim_sample_step(sim, rec))
+        return 0;
+    
+    sim->instruction_address = rec->instruction_address;
+    
+    // the control instruction still in FETCH now knows where it went
+    if (sim->last_opcode == OP_BEQ || sim->last_opcode == OP_JAL || sim->last_opcode == OP_JR)
+        last->mispredicted = mispredicted = iplc_sim_predict(&sim->bp, sim->last_opcode,
+                                                             last->instruction_address,
+                                                             rec->instruction_address);
+    // the BBV counts fetches by basic block, and a control instruction ends one
+    if (sim->intervals.bbv) {
+        if (sim->last_opcode >= OP_BEQ && sim->last_opcode <= OP_JR)
+            sim->intervals.block = ((rec->instruction_address >> 2) * 2654435761U) & (sim->intervals.dims - 1);
+        sim->intervals.bbv[sim->intervals.block]++;
+    }
+    sim->last_opcode = rec->opcode;
+    
+    // what the new instruction reads and writes, for the hazard scoreboard
+    regs.dest = -1;
+    regs.src[0] = -1;
+    regs.src[1] = -1;
+    regs.late_src = -1;
+    switch (rec->opcode) {
+        case OP_SW:
+            regs.src[0] = rec->src_reg2;
+            regs.late_src = rec->src_reg1;
+            break;
+        case OP_JAL:
+            regs.dest = 31;
+            break;
+        default:
+            regs.dest = rec->dest_reg;
+            regs.src[0] = rec->src_reg1;
+            regs.src[1] = rec->src_reg2;
+            break;
+    }
+    
+    instruction_hit = iplc_sim_trap_address(sim, &sim->icache, sim->instruction_address,
+                                            sim->instruction_address, &latency);
+    
+    if (EVENT_ON(sim, EVENT_FETCH))
+        iplc_sim_event(sim, EVENT_TYPE_FETCH, instruction_hit, 0, sim->instruction_address, 0, 0);
+    
+    if (PROFILE_ON(sim) && (hotspot = iplc_sim_profile_entry(&sim->profile, sim->instruction_address))) {
+        hotspot->instructions++;
+        hotspot->icache_misses += !instruction_hit;
+        hotspot->icache_cycles += latency - 1;
+    }
+    
+    // the out-of-order core sees the same fetch, latency and outcome
+    if (sim->ooo.rob_entries)
+        iplc_sim_ooo_fetch(&sim->ooo, opcode_itypes[rec->opcode], &regs, latency, mispredicted);
+    
+    // push current instruction thru pipeline for as long as the fetch takes.
+    // need to subtract 1, since the stage is pushed once more for actual instruction processing
+    // also need to allow for a branch miss prediction during the fetch cache miss time -- by
+    // counting cycles this allows for these cycles to overlap and not doubly count.
+    for (i = 1; i < latency; i++)
+        iplc_sim_push_pipeline_stage(sim);
+    
+    // a fetch that cannot join the group in FETCH starts the next one a cycle on
+    if (!iplc_sim_joins_group(sim, opcode_itypes[rec->opcode], &regs))
+        iplc_sim_push_pipeline_stage(sim);
+    
+    switch (rec->opcode) {
+        case OP_ADD:
+        case OP_ADDI:
+        case OP_ADDIU:
+        case OP_ADDU:
+        case OP_SLL:
+        case OP_ORI:
+        case OP_LUI:
+            iplc_sim_process_pipeline_rtype(sim, rec->dest_reg, rec->src_reg1,
+                                            rec->src_reg2 >= 0 ? rec->src_reg2 : rec->constant);
+            break;
+        case OP_LW:
+            iplc_sim_process_pipeline_lw(sim, rec->dest_reg, rec->src_reg1, rec->data_address);
+            break;
+        case OP_SW:
+            iplc_sim_process_pipeline_sw(sim, rec->src_reg1, rec->src_reg2, rec->data_address);
+            break;
+        case OP_BEQ:
+            sim->branch_count++;
+            iplc_sim_process_pipeline_branch(sim, rec->src_reg1, rec->src_reg2);
+            break;
+        case OP_J:
+        case OP_JAL:
+        case OP_JR:
+            iplc_sim_process_pipeline_jump(sim);
+            break;
+        case OP_SYSCALL:
+            iplc_sim_process_pipeline_syscall(sim);
+            break;
+        case OP_NOP:
+            iplc_sim_process_pipeline_nop(sim);
+            break;
+    }
+    
+    // the pushes above turned the stage ring, FETCH is a different latch now
+    fetch = iplc_sim_stage(sim, FETCH);
+    fetch->slot[fetch->count - 1].regs = regs;
+    
+    if (sim->intervals.length &&
+        (sim->intervals.unit == INTERVAL_CYCLES ? sim->pipeline_cycles : sim->instruction_count) >= sim->intervals.next)
+        iplc_sim_end_interval(sim);
+    
+    if (EVENT_ON(sim, EVENT_PIPELINE))
+        iplc_sim_dump_pipeline(sim);
+    
+    return 0;
+}
+
+
+/*
+ * Finish processing all instructions in the Pipeline.
+ */
+void iplc_sim_drain_pipeline(iplc_sim_t *sim)
+{
+    int i;
+    
+    for (i = 0; i < sim->depth; i++)
+        while (iplc_sim_stage(sim, i)->count)
+            iplc_sim_push_pipeline_stage(sim);
+}
+
+static void iplc_sim_cache_stats(const cache_t *cache, iplc_cache_stats_t *stats)
+{
+    stats->access = cache->access;
+    stats->miss = cache->miss;
+    stats->hit = cache->hit;
+    stats->compulsory = cache->classifier ? cache->classifier->compulsory : 0;
+    stats->capacity = cache->classifier ? cache->classifier->capacity : 0;
+    stats->conflict = cache->classifier ? cache->classifier->conflict : 0;
+}
+
+/*
+ * Drain the pipeline, write out any buffered events and collect our summary
+ * statistics.
+ */
+void iplc_sim_finalize(iplc_sim_t *sim, iplc_sim_stats_t *stats)
+{
+    if (sim->sampler.window)
+        iplc_sim_finish_sampling(sim);
+    iplc_sim_drain_pipeline(sim);
+    if (sim->ooo.rob_entries)
+        iplc_sim_ooo_finish(&sim->ooo);
+    iplc_sim_flush_events(sim);
+    // the last interval is whatever is left, however short
+    if (sim->intervals.length) {
+        iplc_sim_end_interval(sim);
+        if (sim->intervals.ring)
+            iplc_sim_flush_intervals(sim);
+    }
+    
+    iplc_sim_cache_stats(&sim->icache, &stats->icache);
+    iplc_sim_cache_stats(&sim->dcache, &stats->dcache);
+    iplc_sim_cache_stats(&sim->l2, &stats->l2);
+    iplc_sim_cache_stats(&sim->l3, &stats->l3);
+    stats->cache_access = stats->icache.access + stats->dcache.access;
+    stats->cache_miss = stats->icache.miss + stats->dcache.miss;
+    stats->cache_hit = stats->icache.hit + stats->dcache.hit;
+    stats->memory_access = sim->memory_access;
+    stats->levels = sim->config.levels;
+    stats->classified = sim->config.classify_misses;
+    stats->pipeline_depth = sim->depth;
+    stats->issue_width = sim->width;
+    stats->branch = sim->bp.stats;
+    stats->branch.predictor = sim->bp.type;
+    stats->hazard = sim->hazard;
+    stats->hazard.model = sim->hazards;
+    stats->ooo = sim->ooo.stats;
+    stats->interval = sim->intervals.stats;
+    stats->sample = sim->sampler.stats;
+    stats->partitions = 0;
+    stats->mshr = sim->mshr_stats;
+    stats->write = sim->write_stats;
+    stats->icache_prefetch = sim->icache_prefetch.stats;
+    stats->dcache_prefetch = sim->dcache_prefetch.stats;
+    stats->pipeline_cycles = sim->pipeline_cycles;
+    stats->instruction_count = sim->instruction_count;
+    stats->branch_count = sim->branch_count;
+    stats->correct_branch_predictions = sim->correct_branch_predictions;
+}
+
+void iplc_sim_destroy(iplc_sim_t *sim)
+{
+    if (sim == NULL)
+        return;
+    
+    iplc_sim_free_cache(&sim->icache);
+    iplc_sim_free_cache(&sim->dcache);
+    iplc_sim_free_cache(&sim->l2);
+    iplc_sim_free_cache(&sim->l3);
+    iplc_sim_free_prefetcher(&sim->icache_prefetch);
+    iplc_sim_free_prefetcher(&sim->dcache_prefetch);
+    iplc_sim_free_predictor(&sim->bp);
+    iplc_sim_free_ooo(&sim->ooo);
+    iplc_sim_free_profile(&sim->profile);
+    iplc_sim_free_intervals(sim);
+    iplc_sim_free_sampling(sim);
+    iplc_sim_free_events(sim);
+    free(sim);
+}
+
+static double ratio(long part, long whole)
+{
+    return whole ? (double)part / (double)whole : 0.0;
+}
+
+static void iplc_sim_print_cache_stats(FILE *out, const char *name, const iplc_cache_stats_t *stats,
+                                       unsigned int classified)
+{
+    fprintf(out, " %s Performance \n", name);
+    fprintf(out, "\t Number of Accesses is %ld \n", stats->access);
+    fprintf(out, "\t Number of Misses is %ld \n", stats->miss);
+    if (classified)
+        fprintf(out, "\t Compulsory %ld, Capacity %ld, Conflict %ld \n",
+                stats->compulsory, stats->capacity, stats->conflict);
+    fprintf(out, "\t Number of Hits is %ld \n", stats->hit);
+    fprintf(out, "\t Miss Rate is %f \n\n", ratio(stats->miss, stats->access));
+}
+
+/*
+ * Coverage is the share of the misses there would have been without the
+ * prefetcher that it removed, counting late prefetches as not removed;
+ * timeliness the share of useful prefetches that were there in time.
+ */
+static void iplc_sim_print_prefetch_stats(FILE *out, const char *name, const iplc_prefetch_stats_t *stats,
+                                          long misses)
+{
+    long timely = stats->useful - stats->late;
+    
+    fprintf(out, " %s Prefetcher (%s, degree %d, %d entries) \n", name, prefetcher_names[stats->type],
+            stats->degree, stats->entries);
+    fprintf(out, "\t Issued is %ld, Useful is %ld (late %ld), Unused is %ld, Dropped is %ld \n",
+            stats->issued, stats->useful, stats->late, stats->unused, stats->dropped);
+    fprintf(out, "\t Accuracy is %f, Coverage is %f, Timeliness is %f \n", ratio(stats->useful, stats->issued),
+            ratio(timely, misses + timely), ratio(timely, stats->useful));
+    fprintf(out, "\t Pollution Misses is %ld \n\n", stats->pollution);
+}
+
+static void iplc_sim_print_branch_stats(FILE *out, const iplc_branch_stats_t *stats)
+{
+    fprintf(out, "Branch Prediction (%s) \n", predictor_names[stats->predictor]);
+    fprintf(out, "\t Accuracy is %f (%ld of %ld) \n",
+            ratio(stats->correct, stats->predictions), stats->correct, stats->predictions);
+    if (stats->predictor == PREDICTOR_TOURNAMENT)
+        fprintf(out, "\t Bimodal Alone %f, Gshare Alone %f, Gshare Chosen %ld Times \n",
+                ratio(stats->bimodal_correct, stats->predictions),
+                ratio(stats->gshare_correct, stats->predictions), stats->chooser_gshare);
+    if (stats->btb_lookups)
+        fprintf(out, "\t BTB Hit Rate is %f (%ld of %ld) \n",
+                ratio(stats->btb_hits, stats->btb_lookups), stats->btb_hits, stats->btb_lookups);
+    if (stats->ras_predictions)
+        fprintf(out, "\t RAS Accuracy is %f (%ld of %ld) \n",
+                ratio(stats->ras_correct, stats->ras_predictions), stats->ras_correct, stats->ras_predictions);
+    fprintf(out, "\t Mispredict Cycles is %ld (direction %ld, BTB %ld, RAS %ld) \n\n",
+            stats->direction_cycles + stats->btb_cycles + stats->ras_cycles,
+            stats->direction_cycles, stats->btb_cycles, stats->ras_cycles);
+}
+
+static void iplc_sim_print_hazard_stats(FILE *out, const iplc_hazard_stats_t *stats)
+{
+    fprintf(out, "Data Hazards (%s) \n", hazard_names[stats->model]);
+    fprintf(out, "\t Load-Use Stall Cycles is %ld \n", stats->load_use_cycles);
+    fprintf(out, "\t Data Stall Cycles is %ld \n", stats->data_cycles);
+    fprintf(out, "\t Branch Operand Stall Cycles is %ld \n", stats->branch_cycles);
+    fprintf(out, "\t Forwarded from EX/MEM %ld, from MEM/WB %ld \n\n", stats->exmem_forwards, stats->memwb_forwards);
+}
+
+static void iplc_sim_print_ooo_stats(FILE *out, const iplc_ooo_stats_t *stats)
+{
+    fprintf(out, "Out-of-Order Core (ROB %d, IQ %d, LSQ %d) \n", stats->rob_entries, stats->iq_entries,
+            stats->lsq_entries);
+    fprintf(out, "\t Total Cycles is %ld \n", stats->cycles);
+    fprintf(out, "\t CPI is %f \n", ratio(stats->cycles, stats->instructions));
+    fprintf(out, "\t Average ROB Occupancy is %f \n", ratio(stats->rob_occupancy, stats->cycles));
+    fprintf(out, "\t Dispatch Stall Cycles is %ld (ROB full %ld, IQ full %ld, LSQ full %ld) \n",
+            stats->rob_full_cycles + stats->iq_full_cycles + stats->lsq_full_cycles,
+            stats->rob_full_cycles, stats->iq_full_cycles, stats->lsq_full_cycles);
+    fprintf(out, "\t Fetch Stall Cycles is %ld \n\n", stats->fetch_stall_cycles);
+}
+
+static void iplc_sim_print_mshr_stats(FILE *out, const iplc_mshr_stats_t *stats, long cycles)
+{
+    fprintf(out, "Non-Blocking D-Cache (%d MSHRs) \n", stats->mshrs);
+    fprintf(out, "\t Primary Misses is %ld, Merged Secondary Misses is %ld \n",
+            stats->primary_misses, stats->secondary_misses);
+    fprintf(out, "\t Average MSHR Occupancy is %f, Memory-Level Parallelism is %f \n",
+            ratio(stats->busy_cycles, cycles), ratio(stats->busy_cycles, stats->active_cycles));
+    fprintf(out, "\t Miss Latency Overlapped is %ld of %ld Cycles \n",
+            stats->miss_cycles - stats->wait_cycles - stats->full_cycles, stats->miss_cycles);
+    fprintf(out, "\t Stall Cycles is %ld (waiting on data %ld, MSHRs full %ld) \n\n",
+            stats->wait_cycles + stats->full_cycles, stats->wait_cycles, stats->full_cycles);
+}
+
+static void iplc_sim_print_write_stats(FILE *out, const iplc_write_stats_t *stats)
+{
+    fprintf(out, "Write Policy (write-%s, %s, %d Entry Write Buffer) \n", write_policy_names[stats->policy],
+            stats->allocate ? "write-allocate" : "no-write-allocate", stats->buffer_entries);
+    fprintf(out, "\t Stores is %ld, Store Misses is %ld \n", stats->stores, stats->store_misses);
+    fprintf(out, "\t Writebacks is %ld \n", stats->writebacks);
+    fprintf(out, "\t Writes Below the D-Cache is %ld (%ld coalesced), %ld Bytes \n",
+            stats->writes, stats->coalesced, stats->bytes);
+    fprintf(out, "\t Stall Cycles is %ld (stores %ld, writebacks %ld, write buffer full %ld) \n\n",
+            stats->store_cycles + stats->writeback_cycles, stats->store_cycles, stats->writeback_cycles,
+            stats->buffer_full_cycles);
+}
+
+static void iplc_sim_print_interval_stats(FILE *out, const iplc_interval_stats_t *stats)
+{
+    fprintf(out, "Intervals (every %d %s) \n", stats->length, interval_unit_names[stats->unit]);
+    fprintf(out, "\t Intervals is %ld \n", stats->intervals);
+    fprintf(out, "\t Interval CPI is %f to %f \n", stats->min_cpi, stats->max_cpi);
+    if (stats->bbv_dims)
+        fprintf(out, "\t Phases is %d (%d dimension BBVs) \n", stats->phases, stats->bbv_dims);
+    fprintf(out, "\n");
+}
+
+static void iplc_sim_print_sample_stats(FILE *out, const iplc_sample_stats_t *stats)
+{
+    if (stats->simpoints)
+        fprintf(out, "Sampling (%d SimPoints of %ld instructions, %ld warmup) \n", stats->simpoints,
+                stats->window, stats->warmup);
+    else
+        fprintf(out, "Sampling (%ld instructions every %ld, %ld warmup) \n", stats->window, stats->period,
+                stats->warmup);
+    fprintf(out, "\t Windows is %ld \n", stats->windows);
+    fprintf(out, "\t Detailed Instructions is %ld of %ld \n", stats->detailed_instructions, stats->instructions);
+    fprintf(out, "\t Sampled CPI is %f +/- %f (95%% confidence) \n", stats->cpi, stats->cpi_bound);
+    fprintf(out, "\t Estimated Cycles is %.0f \n\n", stats->estimated_cycles);
+}
+
+/*
+ * Just output our summary statistics, totals first and then per cache.
+ */
+void iplc_sim_print_stats(FILE *out, const iplc_sim_stats_t *stats)
+{
+    fprintf(out, " Cache Performance \n");
+    fprintf(out, "\t Number of Cache Accesses is %ld \n", stats->cache_access);
+    fprintf(out, "\t Number of Cache Misses is %ld \n", stats->cache_miss);
+    fprintf(out, "\t Number of Cache Hits is %ld \n", stats->cache_hit);
+    fprintf(out, "\t Cache Miss Rate is %f \n\n", (double)stats->cache_miss / (double)stats->cache_access);
+    iplc_sim_print_cache_stats(out, "I-Cache", &stats->icache, stats->classified);
+    iplc_sim_print_cache_stats(out, "D-Cache", &stats->dcache, stats->classified);
+    if (stats->levels > 1)
+        iplc_sim_print_cache_stats(out, "L2", &stats->l2, stats->classified);
+    if (stats->levels > 2)
+        iplc_sim_print_cache_stats(out, "L3", &stats->l3, stats->classified);
+    if (stats->levels > 1)
+        fprintf(out, " Memory Accesses is %ld \n\n", stats->memory_access);
+    if (stats->partitions) {
+        // a cache-only run has no pipeline to report on
+        fprintf(out, "Cache-Only Simulation (%d partitions) \n", stats->partitions);
+        fprintf(out, "\t Total Instructions is %ld \n\n", stats->instruction_count);
+        return;
+    }
+    if (stats->icache_prefetch.type != PREFETCH_NONE)
+        iplc_sim_print_prefetch_stats(out, "I-Cache", &stats->icache_prefetch, stats->icache.miss);
+    if (stats->dcache_prefetch.type != PREFETCH_NONE)
+        iplc_sim_print_prefetch_stats(out, "D-Cache", &stats->dcache_prefetch, stats->dcache.miss);
+    fprintf(out, "Pipeline Performance \n");
+    if (stats->pipeline_depth != 5 || stats->issue_width != 1)
+        fprintf(out, "\t Depth is %d Stages, Issue Width is %d \n", stats->pipeline_depth, stats->issue_width);
+    fprintf(out, "\t Total Cycles is %ld \n", stats->pipeline_cycles);
+    fprintf(out, "\t Total Instructions is %ld \n", stats->instruction_count);
+    fprintf(out, "\t Total Branch Instructions is %ld \n", stats->branch_count);
+    fprintf(out, "\t Total Correct Branch Predictions is %ld \n", stats->correct_branch_predictions);
+    fprintf(out, "\t CPI is %f \n\n", (double)stats->pipeline_cycles / (double)stats->instruction_count);
+    iplc_sim_print_branch_stats(out, &stats->branch);
+    if (stats->hazard.model != HAZARDS_OFF)
+        iplc_sim_print_hazard_stats(out, &stats->hazard);
+    if (stats->write.policy != WRITE_OFF)
+        iplc_sim_print_write_stats(out, &stats->write);
+    if (stats->mshr.mshrs)
+        iplc_sim_print_mshr_stats(out, &stats->mshr, stats->pipeline_cycles);
+    if (stats->ooo.rob_entries)
+        iplc_sim_print_ooo_stats(out, &stats->ooo);
+    if (stats->interval.length)
+        iplc_sim_print_interval_stats(out, &stats->interval);
+    if (stats->sample.window)
+        iplc_sim_print_sample_stats(out, &stats->sample);
+}
+
+/*
+ * The top hotspots from iplc_sim_profile(), each with its stall cycles
+ * split by cause and the share of all cycles they make up.
+ */
+void iplc_sim_print_profile(FILE *out, const iplc_profile_entry_t *entries, int count, int top,
+                            long cycles)
+{
+    int i;
+    
+    if (top > count)
+        top = count;
+    fprintf(out, "Hotspots (top %d of %d instruction addresses by stall cycles) \n", top, count);
+    fprintf(out, "\t %-10s %9s %7s %7s %7s %9s %6s  %s \n", "PC", "Executed", "I-Miss", "D-Miss",
+            "Mispred", "Stalls", "Cycle%", "I-Cache/D-Cache/Hazard/Branch");
+    for (i = 0; i < top; i++)
+        fprintf(out, "\t 0x%08x %9ld %7ld %7ld %7ld %9ld %6.2f  %ld/%ld/%ld/%ld \n", entries[i].pc,
+                entries[i].instructions, entries[i].icache_misses, entries[i].dcache_misses,
+                entries[i].mispredicts, entries[i].stall_cycles, 100.0 * ratio(entries[i].stall_cycles, cycles),
+                entries[i].icache_cycles, entries[i].dcache_cycles, entries[i].hazard_cycles,
+                entries[i].branch_cycles);
+    fprintf(out, "\n");
+}
+
+/************************************************************************************************/
+/* Pipeline Functions ***************************************************************************/
+/************************************************************************************************/
+
+/*
+ * What role a stage plays, as enum pipeline_stages: everything in front of
+ * decode fetches.
+ */
+static int iplc_sim_stage_role(const iplc_sim_t *sim, int stage)
+{
+    return stage < sim->decode ? FETCH : stage - sim->decode + DECODE;
+}
+
+/*
+ * Dump the current contents of our pipeline, one event per issue slot of
+ * every stage; empty slots show up as NOPs at 0x0.
+ */
+void iplc_sim_dump_pipeline(iplc_sim_t *sim)
+{
+    const stage_t *stage;
+    int i, j;
+    
+    for (i = 0; i < sim->depth; i++) {
+        stage = iplc_sim_stage(sim, i);
+        for (j = 0; j < sim->width; j++)
+            iplc_sim_event(sim, EVENT_TYPE_STAGE, iplc_sim_stage_role(sim, i),
+                           j < stage->count ? stage->slot[j].itype : NOP,
+                           j < stage->count ? stage->slot[j].instruction_address : 0,
+                           sim->pipeline_cycles, (i << 16) | (sim->width << 8) | j);
+    }
+}
+
+/*
+ * Count the instructions in WRITEBACK as retired.
+ */
+static void iplc_sim_writeback_stage(iplc_sim_t *sim)
+{
+    const stage_t *stage = iplc_sim_stage(sim, sim->writeback);
+    int i;
+    
+    for (i = 0; i < stage->count; i++) {
+        if (stage->slot[i].instruction_address) {
+            sim->instruction_count++;
+            if (EVENT_ON(sim, EVENT_RETIRE))
+                iplc_sim_event(sim, EVENT_TYPE_RETIRE, 0, stage->slot[i].itype,
+                               stage->slot[i].instruction_address, sim->pipeline_cycles, 0);
+        }
+    }
+}
+
+/*
+ * Charge a lw or sw its D-cache miss and the cycles MEM stalled for it
+ * since start.
+ */
+static void iplc_sim_profile_memory(iplc_sim_t *sim, unsigned int pc, int hit, long start)
+{
+    iplc_profile_entry_t *hotspot = iplc_sim_profile_entry(&sim->profile, pc);
+    
+    if (hotspot) {
+        hotspot->dcache_misses += !hit;
+        hotspot->dcache_cycles += sim->pipeline_cycles - start;
+    }
+}
+
+/*
+ * Send the LW or SW in MEM to the D-cache and stall for whatever its latency
+ * is beyond the one cycle MEM takes anyway.  Issue groups never hold more
+ * than one, there is a single D-cache port.  With MSHRs nothing stalls
+ * here unless they are all busy; a lw instead marks when its register will
+ * be ready, which a later write to the register clears again.  A sw goes
+ * through the write policy, and under one only needs an MSHR when it has
+ * to wait on something.
+ */
+static void iplc_sim_memory_stage(iplc_sim_t *sim)
+{
+    const stage_t *stage = iplc_sim_stage(sim, sim->mem);
+    long ready, start;
+    int i, dest;
+    
+    for (i = 0; i < stage->count; i++) {
+        ready = 0;
+        start = sim->pipeline_cycles;
+        if (stage->slot[i].itype == LW) {
+            int instructionAddress = stage->slot[i].stage.lw.data_address;
+            unsigned int latency;
+            int hit = iplc_sim_trap_address(sim, &sim->dcache, stage->slot[i].instruction_address,
+                                            instructionAddress, &latency);
+            if (EVENT_ON(sim, EVENT_DATA))
+                iplc_sim_event(sim, EVENT_TYPE_LW, hit, 0, instructionAddress, 0, 0);
+            // MEM already takes one cycle
+            if (sim->num_mshrs)
+                ready = iplc_sim_mshr_access(sim, instructionAddress, hit, latency);
+            else
+                sim->pipeline_cycles += latency - 1;
+            if (PROFILE_ON(sim))
+                iplc_sim_profile_memory(sim, stage->slot[i].instruction_address, hit, start);
+            if (sim->ooo.rob_entries)
+                iplc_sim_ooo_memory(&sim->ooo, latency);
+        }
+        
+        if (stage->slot[i].itype == SW) {
+            int instructionAddress = stage->slot[i].stage.sw.data_address;
+            unsigned int latency;
+            int hit = iplc_sim_trap_store(sim, stage->slot[i].instruction_address, instructionAddress, &latency);
+            if (EVENT_ON(sim, EVENT_DATA))
+                iplc_sim_event(sim, EVENT_TYPE_SW, hit, 0, instructionAddress, 0, 0);
+            if (sim->num_mshrs)
+                iplc_sim_mshr_access(sim, instructionAddress, sim->write_policy == WRITE_OFF ? hit :
+                                     latency <= (unsigned int) sim->dcache.latency, latency);
+            else {
+                sim->pipeline_cycles += latency - 1;
+                sim->write_stats.store_cycles += latency - 1;
+            }
+            if (PROFILE_ON(sim))
+                iplc_sim_profile_memory(sim, stage->slot[i].instruction_address, hit, start);
+            if (sim->ooo.rob_entries)
+                iplc_sim_ooo_memory(&sim->ooo, latency);
+        }
+        
+        dest = stage->slot[i].regs.dest;
+        if (sim->num_mshrs && dest > 0 && dest < 32)
+            sim->reg_ready[dest] = ready;
+    }
+}
+
+static uint32_t reg_bit(int reg)
+{
+    return (reg > 0 && reg < 32) ? 1U << reg : 0;
+}
+
+/*
+ * Registers the instructions of a stage have yet to write, and which of
+ * those come from loads.
+ */
+static uint32_t iplc_sim_stage_dests(iplc_sim_t *sim, int stage_number, uint32_t *loads)
+{
+    const stage_t *stage = iplc_sim_stage(sim, stage_number);
+    uint32_t dests = 0, bit;
+    int i;
+    
+    *loads = 0;
+    for (i = 0; i < stage->count; i++) {
+        bit = reg_bit(stage->slot[i].regs.dest);
+        dests |= bit;
+        if (stage->slot[i].itype == LW)
+            *loads |= bit;
+    }
+    return dests;
+}
+
+static int reg_pending(const iplc_sim_t *sim, int reg)
+{
+    return reg > 0 && reg < 32 && sim->reg_ready[reg] > sim->pipeline_cycles;
+}
+
+/*
+ * With MSHRs: an instruction in ALU needs its operands now, or the sw
+ * value by MEM, and beq and jr need theirs in DECODE.  Returns the enum
+ * hazard_cause for one still waiting on a lw miss, and that instruction
+ * in waiting.
+ */
+static int iplc_sim_miss_hazard(iplc_sim_t *sim, const pipeline_t **waiting)
+{
+    const stage_t *alu = iplc_sim_stage(sim, sim->alu);
+    const stage_t *decode = iplc_sim_stage(sim, sim->decode);
+    int i;
+    
+    for (i = 0; i < alu->count; i++)
+        if (reg_pending(sim, alu->slot[i].regs.src[0]) || reg_pending(sim, alu->slot[i].regs.src[1]) ||
+            reg_pending(sim, alu->slot[i].regs.late_src)) {
+            *waiting = &alu->slot[i];
+            return HAZARD_MISS_ALU;
+        }
+    for (i = 0; i < decode->count; i++)
+        if ((decode->slot[i].itype == BRANCH || decode->slot[i].itype == JUMP) &&
+            (reg_pending(sim, decode->slot[i].regs.src[0]) || reg_pending(sim, decode->slot[i].regs.src[1]))) {
+            *waiting = &decode->slot[i];
+            return HAZARD_MISS_DECODE;
+        }
+    return HAZARD_NONE;
+}
+
+/*
+ * The scoreboard: which registers the instructions in ALU and MEM have yet
+ * to write, and which of those are loads, after any wait on a lw miss.
+ * Returns the enum hazard_cause keeping the group in DECODE from moving on
+ * this cycle, the one of its oldest waiting instruction, which goes in
+ * waiting, and once nothing waits counts the forwarding paths the group
+ * uses.  beq and jr compare their operands in DECODE, everything else needs
+ * them at the start of ALU, and the sw value not until MEM.
+ */
+static int iplc_sim_hazard(iplc_sim_t *sim, const pipeline_t **waiting)
+{
+    const stage_t *decode = iplc_sim_stage(sim, sim->decode);
+    uint32_t alu_load, mem_load;
+    uint32_t alu = iplc_sim_stage_dests(sim, sim->alu, &alu_load);
+    uint32_t mem = iplc_sim_stage_dests(sim, sim->mem, &mem_load);
+    uint32_t early, late;
+    int i, control, cause;
+    
+    if (sim->num_mshrs && (cause = iplc_sim_miss_hazard(sim, waiting)) != HAZARD_NONE)
+        return cause;
+    if (sim->hazards == HAZARDS_OFF)
+        return HAZARD_NONE;
+    
+    for (i = 0; i < decode->count; i++) {
+        early = reg_bit(decode->slot[i].regs.src[0]) | reg_bit(decode->slot[i].regs.src[1]);
+        late = reg_bit(decode->slot[i].regs.late_src);
+        control = decode->slot[i].itype == BRANCH || decode->slot[i].itype == JUMP;
+        *waiting = &decode->slot[i];
+        
+        if (control && (early & (sim->hazards == HAZARDS_FORWARD ? alu | mem_load : alu | mem)))
+            return HAZARD_BRANCH;
+        if (!control && sim->hazards == HAZARDS_STALL && ((early | late) & (alu | mem)))
+            return HAZARD_DATA;
+        if (!control && sim->hazards == HAZARDS_FORWARD && (early & alu_load))
+            return HAZARD_LOAD_USE;
+    }
+    
+    if (sim->hazards != HAZARDS_FORWARD)
+        return HAZARD_NONE;
+    for (i = 0; i < decode->count; i++) {
+        early = reg_bit(decode->slot[i].regs.src[0]) | reg_bit(decode->slot[i].regs.src[1]);
+        late = reg_bit(decode->slot[i].regs.late_src);
+        if (decode->slot[i].itype == BRANCH || decode->slot[i].itype == JUMP) {
+            sim->hazard.exmem_forwards += __builtin_popcount(early & mem);
+        } else {
+            sim->hazard.exmem_forwards += __builtin_popcount(early & alu);
+            sim->hazard.memwb_forwards += __builtin_popcount((early & mem & ~alu) | (late & alu));
+        }
+    }
+    return HAZARD_NONE;
+}
+
+/*
+ * Whether an instruction fetched this cycle can join the issue group in
+ * FETCH.  Groups are in order and at most width wide, end at a branch or
+ * jump, carry one lw or sw for the single D-cache port, and unless hazards
+ * are off never hold an instruction together with the one it reads from.
+ */
+int iplc_sim_joins_group(iplc_sim_t *sim, int itype, const hazard_regs_t *regs)
+{
+    const stage_t *fetch = iplc_sim_stage(sim, FETCH);
+    uint32_t reads = reg_bit(regs->src[0]) | reg_bit(regs->src[1]) | reg_bit(regs->late_src);
+    int i;
+    
+    if (fetch->count == 0 || fetch->count == sim->width)
+        return 0;
+    for (i = 0; i < fetch->count; i++) {
+        if (fetch->slot[i].itype == BRANCH || fetch->slot[i].itype == JUMP)
+            return 0;
+        if ((itype == LW || itype == SW) && (fetch->slot[i].itype == LW || fetch->slot[i].itype == SW))
+            return 0;
+        if (sim->hazards != HAZARDS_OFF && (reads & reg_bit(fetch->slot[i].regs.dest)))
+            return 0;
+    }
+    return 1;
+}
+
+/*
+ * One cycle in which only stage and the ones behind it move on: the stages
+ * in front of it hold and a bubble goes into stage.  Unlike a full cycle
+ * this copies latches, but it only happens on stalls.
+ */
+static void iplc_sim_stall_pipeline(iplc_sim_t *sim, int stage)
+{
+    stage_t *to, *from;
+    int i;
+    
+    iplc_sim_writeback_stage(sim);
+    iplc_sim_memory_stage(sim);
+    sim->pipeline_cycles++;
+    
+    for (i = sim->writeback; i > stage; i--) {
+        to = iplc_sim_stage(sim, i);
+        from = iplc_sim_stage(sim, i - 1);
+        memcpy(to->slot, from->slot, from->count * sizeof(pipeline_t));
+        to->count = from->count;
+    }
+    iplc_sim_stage(sim, stage)->count = 0;
+}
+
+/*
+ * Check if various stages of our pipeline require stalls, mispredict
+ * penalties and so on.  Then move every stage on one cycle, which is just a
+ * turn of the stage ring whatever the depth.
+ */
+void iplc_sim_push_pipeline_stage(iplc_sim_t *sim)
+{
+    const stage_t *decode;
+    const pipeline_t *waiting = NULL;
+    iplc_profile_entry_t *hotspot;
+    unsigned int mispredicted_pc = 0;
+    int cause, mispredicted = MISPREDICT_NONE, i;
+    
+    /* 0. Hold DECODE until the scoreboard says its operands can be had, and
+     *    with MSHRs hold ALU too while it waits on a lw miss */
+    while ((cause = iplc_sim_hazard(sim, &waiting)) != HAZARD_NONE) {
+        // charged before the stall copies the latch waiting points into
+        if (PROFILE_ON(sim) && (hotspot = iplc_sim_profile_entry(&sim->profile, waiting->instruction_address))) {
+            if (cause == HAZARD_MISS_ALU || cause == HAZARD_MISS_DECODE)
+                hotspot->dcache_cycles++;
+            else
+                hotspot->hazard_cycles++;
+        }
+        iplc_sim_stall_pipeline(sim, cause == HAZARD_MISS_ALU ? sim->mem : sim->alu);
+        switch (cause) {
+            case HAZARD_MISS_ALU:
+            case HAZARD_MISS_DECODE:
+                sim->mshr_stats.wait_cycles++;
+                break;
+            case HAZARD_LOAD_USE:
+                sim->hazard.load_use_cycles++;
+                break;
+            case HAZARD_DATA:
+                sim->hazard.data_cycles++;
+                break;
+            default:
+                sim->hazard.branch_cycles++;
+                break;
+        }
+    }
+    
+    /* 1. Check for BRANCH and correct/incorrect Branch Prediction.  The
+     *    outcome was settled by iplc_sim_predict() once the next fetch was
+     *    known; a jr only ever mispredicts when there is a RAS.  A wrong
+     *    guess costs one bubble per stage in front of DECODE while the
+     *    right path is fetched again. */
+    decode = iplc_sim_stage(sim, sim->decode);
+    for (i = 0; i < decode->count; i++) {
+        if (decode->slot[i].itype != BRANCH && decode->slot[i].itype != JUMP)
+            continue;
+        if (decode->slot[i].mispredicted) {
+            mispredicted = decode->slot[i].mispredicted;
+            mispredicted_pc = decode->slot[i].instruction_address;
+        }
+        else if (decode->slot[i].itype == BRANCH)
+            sim->correct_branch_predictions++;
+    }
+    if (mispredicted) {
+        if (PROFILE_ON(sim) && (hotspot = iplc_sim_profile_entry(&sim->profile, mispredicted_pc))) {
+            hotspot->mispredicts++;
+            hotspot->branch_cycles += sim->decode;
+        }
+        for (i = 0; i < sim->decode; i++) {
+            iplc_sim_stall_pipeline(sim, sim->decode);
+            switch (mispredicted) {
+                case MISPREDICT_DIRECTION:
+                    sim->bp.stats.direction_cycles++;
+                    break;
+                case MISPREDICT_BTB:
+                    sim->bp.stats.btb_cycles++;
+                    break;
+                default:
+                    sim->bp.stats.ras_cycles++;
+                    break;
+            }
+        }
+    }
+    
+    /* 2. Count WRITEBACK stage is "retired" */
+    iplc_sim_writeback_stage(sim);
+    
+    /* 3. LW and SW data accesses, adding delay cycles if needed */
+    iplc_sim_memory_stage(sim);
+    
+    /* 4. Increment pipe_cycles 1 cycle for normal processing */
+    sim->pipeline_cycles++;
+    
+    /* 5. Every stage moves on: the retired WRITEBACK latch comes round as
+     *    the new, empty FETCH */
+    sim->head = sim->head ? sim->head - 1 : sim->depth - 1;
+    iplc_sim_stage(sim, FETCH)->count = 0;
+}
+
+/*
+ * The next free slot of the group in FETCH, cleared and holding the
+ * instruction being fetched.
+ */
+static pipeline_t *iplc_sim_fetch_slot(iplc_sim_t *sim, enum instruction_type itype)
+{
+    stage_t *fetch = iplc_sim_stage(sim, FETCH);
+    pipeline_t *slot = &fetch->slot[fetch->count++];
+    
+    bzero(slot, sizeof(pipeline_t));
+    slot->itype = itype;
+    slot->instruction_address = sim->instruction_address;
+    return slot;
+}
+
+/*
+ * This function is fully implemented.  You should use this as a reference
+ * for implementing the remaining instruction types.
+ */
+void iplc_sim_process_pipeline_rtype(iplc_sim_t *sim, int dest_reg, int reg1, int reg2_or_constant) {
+    pipeline_t *fetch = iplc_sim_fetch_slot(sim, RTYPE);
+    
+    fetch->stage.rtype.reg1 = reg1;
+    fetch->stage.rtype.reg2_or_constant = reg2_or_constant;
+    fetch->stage.rtype.dest_reg = dest_reg;
+}
+
+void iplc_sim_process_pipeline_lw(iplc_sim_t *sim, int dest_reg, int base_reg, unsigned int data_address) {
+    pipeline_t *fetch = iplc_sim_fetch_slot(sim, LW);
+    
+    fetch->stage.lw.base_reg = base_reg;
+    fetch->stage.lw.dest_reg = dest_reg;
+    fetch->stage.lw.data_address = data_address;
+}
+
+void iplc_sim_process_pipeline_sw(iplc_sim_t *sim, int src_reg, int base_reg, unsigned int data_address) {
+    pipeline_t *fetch = iplc_sim_fetch_slot(sim, SW);
+    
+    fetch->stage.sw.src_reg = src_reg;
+    fetch->stage.sw.base_reg = base_reg;
+    fetch->stage.sw.data_address = data_address;
+}
+
+void iplc_sim_process_pipeline_branch(iplc_sim_t *sim, int reg1, int reg2) {
+    pipeline_t *fetch = iplc_sim_fetch_slot(sim, BRANCH);
+    
+    fetch->stage.branch.reg1 = reg1;
+    fetch->stage.branch.reg2 = reg2;
+}
+
+void iplc_sim_process_pipeline_jump(iplc_sim_t *sim) {
+    iplc_sim_fetch_slot(sim, JUMP);
+}
+
+void iplc_sim_process_pipeline_syscall(iplc_sim_t *sim) {
+    iplc_sim_fetch_slot(sim, SYSCALL);
+}
+
+void iplc_sim_process_pipeline_nop(iplc_sim_t *sim) {
+    iplc_sim_fetch_slot(sim, NOP);
+}
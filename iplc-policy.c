@@ -0,0 +1,253 @@
+/***********************************************************************/
+/***********************************************************************
+ Pipeline Cache Simulator -- replacement policies
+ ***********************************************************************/
+/***********************************************************************/
+#include "iplc-internal.h"
+
+const char *policy_names[NUM_POLICIES] = {
+    "lru", "plru", "srrip", "brrip", "fifo", "random"
+};
+
+/*
+ * Look a policy up by its name, -1 if there is no such policy.
+ */
+int iplc_sim_policy_by_name(const char *name)
+{
+    int i;
+
+    for (i = 0; i < NUM_POLICIES; i++)
+        if (strcmp(name, policy_names[i]) == 0)
+            return i;
+    return -1;
+}
+
+/*
+ * xorshift32, one stream per cache so results only depend on the seed.
+ */
+static uint32_t policy_random(cache_t *cache)
+{
+    uint32_t x = cache->rng;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    cache->rng = x;
+    return x;
+}
+
+/************************************************************************************************/
+/* True LRU *************************************************************************************/
+/************************************************************************************************/
+/*
+ * Circular doubly linked list of the ways in recency order: state[0] is the
+ * MRU way, next[] runs towards the LRU end and prev[mru] is the LRU way, so
+ * touching a way and finding the victim are both O(1).
+ */
+static size_t lru_state_size(const cache_t *cache)
+{
+    return 1 + 2 * cache->assoc;
+}
+
+static void lru_init(cache_t *cache, uint8_t *state)
+{
+    uint8_t *next = state + 1, *prev = state + 1 + cache->assoc;
+    int i;
+
+    state[0] = 0;
+    for (i = 0; i < cache->assoc; i++) {
+        next[i] = (i + 1) % cache->assoc;
+        prev[i] = (i + cache->assoc - 1) % cache->assoc;
+    }
+}
+
+static void lru_touch(cache_t *cache, uint8_t *state, int way)
+{
+    uint8_t *next = state + 1, *prev = state + 1 + cache->assoc;
+    int mru = state[0], lru;
+
+    if (way == mru)
+        return;
+
+    // unlink
+    next[prev[way]] = next[way];
+    prev[next[way]] = prev[way];
+
+    // relink between the LRU way and the old MRU way
+    lru = prev[mru];
+    next[lru] = way;
+    prev[way] = lru;
+    next[way] = mru;
+    prev[mru] = way;
+    state[0] = way;
+}
+
+static int lru_victim(cache_t *cache, uint8_t *state)
+{
+    return state[1 + cache->assoc + state[0]];
+}
+
+/************************************************************************************************/
+/* Tree PLRU ************************************************************************************/
+/************************************************************************************************/
+/*
+ * One bit per node of a binary tree over the ways (heap numbered from 1),
+ * pointing away from the most recently used half.  A non power of two assoc
+ * uses the tree for the next power of two and never descends into a
+ * subtree with no real ways.
+ */
+static size_t plru_state_size(const cache_t *cache)
+{
+    return (cache->plru_leaves + 7) / 8;
+}
+
+static void plru_init(cache_t *cache, uint8_t *state)
+{
+    bzero(state, plru_state_size(cache));
+}
+
+static void plru_touch(cache_t *cache, uint8_t *state, int way)
+{
+    int node = 1, level, d;
+
+    for (level = cache->plru_levels - 1; level >= 0; level--) {
+        d = (way >> level) & 1;
+        if (d)
+            state[node >> 3] &= ~(1 << (node & 7));
+        else
+            state[node >> 3] |= 1 << (node & 7);
+        node = 2 * node + d;
+    }
+}
+
+static int plru_victim(cache_t *cache, uint8_t *state)
+{
+    int node = 1, level, d;
+
+    for (level = cache->plru_levels - 1; level >= 0; level--) {
+        d = (state[node >> 3] >> (node & 7)) & 1;
+        // right subtree starts past the last real way
+        if (d && ((((2 * node + 1) << level) - cache->plru_leaves) >= cache->assoc))
+            d = 0;
+        node = 2 * node + d;
+    }
+    return node - cache->plru_leaves;
+}
+
+/************************************************************************************************/
+/* SRRIP / BRRIP ********************************************************************************/
+/************************************************************************************************/
+/*
+ * 2-bit re-reference prediction values stored as two bit planes, so finding
+ * a distant (RRPV 3) way and ageing every way are a handful of word
+ * operations per 64 ways.
+ */
+#define RRPV_MAX 3
+
+static size_t rrip_state_size(const cache_t *cache)
+{
+    return 2 * cache->valid_words * sizeof(uint64_t);
+}
+
+static void rrip_init(cache_t *cache, uint8_t *state)
+{
+    bzero(state, rrip_state_size(cache));
+}
+
+static void rrip_set(cache_t *cache, uint8_t *state, int way, int rrpv)
+{
+    uint64_t *hi = (uint64_t *) state, *lo = hi + cache->valid_words;
+    uint64_t bit = 1ULL << (way & 63);
+
+    hi[way >> 6] = (rrpv & 2) ? (hi[way >> 6] | bit) : (hi[way >> 6] & ~bit);
+    lo[way >> 6] = (rrpv & 1) ? (lo[way >> 6] | bit) : (lo[way >> 6] & ~bit);
+}
+
+static void rrip_hit(cache_t *cache, uint8_t *state, int way)
+{
+    rrip_set(cache, state, way, 0);
+}
+
+static int rrip_victim(cache_t *cache, uint8_t *state)
+{
+    uint64_t *hi = (uint64_t *) state, *lo = hi + cache->valid_words;
+    uint64_t distant;
+    int w, age;
+
+    for (age = 0; age <= RRPV_MAX; age++) {
+        for (w = 0; w < cache->valid_words; w++) {
+            distant = hi[w] & lo[w] & cache->way_mask[w];
+            if (distant)
+                return w * 64 + __builtin_ctzll(distant);
+        }
+        // nobody is at RRPV_MAX, so every way can be aged without saturating
+        for (w = 0; w < cache->valid_words; w++) {
+            hi[w] = (hi[w] ^ lo[w]) & cache->way_mask[w];
+            lo[w] = ~lo[w] & cache->way_mask[w];
+        }
+    }
+    return 0;
+}
+
+static void srrip_fill(cache_t *cache, uint8_t *state, int way)
+{
+    rrip_set(cache, state, way, RRPV_MAX - 1);
+}
+
+static void brrip_fill(cache_t *cache, uint8_t *state, int way)
+{
+    // mostly insert as distant, as long once every 32 fills
+    rrip_set(cache, state, way, (policy_random(cache) & 31) ? RRPV_MAX : RRPV_MAX - 1);
+}
+
+/************************************************************************************************/
+/* FIFO and random ******************************************************************************/
+/************************************************************************************************/
+static size_t fifo_state_size(const cache_t *cache)
+{
+    return 1;
+}
+
+static void fifo_init(cache_t *cache, uint8_t *state)
+{
+    state[0] = 0;
+}
+
+static void fifo_hit(cache_t *cache, uint8_t *state, int way)
+{
+}
+
+static int fifo_victim(cache_t *cache, uint8_t *state)
+{
+    return state[0];
+}
+
+static void fifo_fill(cache_t *cache, uint8_t *state, int way)
+{
+    if (way == state[0])
+        state[0] = (way + 1) % cache->assoc;
+}
+
+static size_t random_state_size(const cache_t *cache)
+{
+    return 0;
+}
+
+static void random_init(cache_t *cache, uint8_t *state)
+{
+}
+
+static int random_victim(cache_t *cache, uint8_t *state)
+{
+    return policy_random(cache) % cache->assoc;
+}
+
+const cache_policy_t cache_policies[NUM_POLICIES] = {
+    /* state_size,        init,        hit,        victim,        fill */
+    { lru_state_size,    lru_init,    lru_touch,  lru_victim,    lru_touch   },
+    { plru_state_size,   plru_init,   plru_touch, plru_victim,   plru_touch  },
+    { rrip_state_size,   rrip_init,   rrip_hit,   rrip_victim,   srrip_fill  },
+    { rrip_state_size,   rrip_init,   rrip_hit,   rrip_victim,   brrip_fill  },
+    { fifo_state_size,   fifo_init,   fifo_hit,   fifo_victim,   fifo_fill   },
+    { random_state_size, random_init, fifo_hit,   random_victim, fifo_hit    },
+};
@@ -0,0 +1,234 @@
+/***********************************************************************/
+/***********************************************************************
+ Pipeline Cache Simulator -- prefetchers
+ ***********************************************************************/
+/***********************************************************************/
+#include "iplc-internal.h"
+
+const char *prefetcher_names[NUM_PREFETCHERS] = {
+    "none", "next", "stride", "stream"
+};
+
+/*
+ * Look a prefetcher up by its name, -1 if there is no such prefetcher.
+ */
+int iplc_sim_prefetcher_by_name(const char *name)
+{
+    int i;
+
+    for (i = 0; i < NUM_PREFETCHERS; i++)
+        if (strcmp(name, prefetcher_names[i]) == 0)
+            return i;
+    return -1;
+}
+
+/************************************************************************************************/
+/* Prefetcher Functions *************************************************************************/
+/************************************************************************************************/
+
+/*
+ * Set pf up for config and hang it off cache; nothing is attached for
+ * PREFETCH_NONE.  Returns -1 if memory runs out.
+ */
+int iplc_sim_init_prefetcher(prefetcher_t *pf, cache_t *cache, const iplc_prefetch_config_t *config)
+{
+    bzero(pf, sizeof(prefetcher_t));
+    pf->stats.type = config->type;
+    pf->stats.degree = config->degree;
+    pf->stats.entries = config->entries;
+    if (config->type == PREFETCH_NONE)
+        return 0;
+
+    pf->policy = &prefetch_policies[config->type];
+    pf->degree = config->degree;
+    pf->entries = config->entries;
+    pf->block_bits = cache->blockoffsetbits;
+    pf->state = calloc(1, pf->policy->state_size(pf) + 1);
+    if (pf->state == NULL)
+        return -1;
+    pf->policy->init(pf);
+    cache->prefetcher = pf;
+    return 0;
+}
+
+void iplc_sim_free_prefetcher(prefetcher_t *pf)
+{
+    free(pf->state);
+    bzero(pf, sizeof(prefetcher_t));
+}
+
+/************************************************************************************************/
+/* Next-N-Line **********************************************************************************/
+/************************************************************************************************/
+/*
+ * Tagged next-line: a miss, or the first use of a block a prefetch brought
+ * in, fetches the degree blocks after it.
+ */
+static size_t next_state_size(const prefetcher_t *pf)
+{
+    return 0;
+}
+
+static void next_init(prefetcher_t *pf)
+{
+}
+
+static int next_train(prefetcher_t *pf, unsigned int pc, unsigned int address, int outcome,
+                      unsigned int *addresses)
+{
+    unsigned int block = address >> pf->block_bits;
+    int i;
+
+    if (outcome == PREFETCH_HIT)
+        return 0;
+    for (i = 0; i < pf->degree; i++)
+        addresses[i] = (block + 1 + i) << pf->block_bits;
+    return pf->degree;
+}
+
+/************************************************************************************************/
+/* Stride (RPT) *********************************************************************************/
+/************************************************************************************************/
+/*
+ * Reference prediction table: per PC the last address, the stride between
+ * the last two and a 2-bit confidence.  A repeated stride raises the
+ * confidence and a new one lowers it, replacing the stride once it is
+ * down to 0.  From 2 up the next degree strides are prefetched.  On the
+ * I-cache every PC is its own address, so this only does anything for
+ * the D-cache.
+ */
+typedef struct rpt_entry
+{
+    uint32_t      pc;
+    uint32_t      last;
+    int32_t       stride;
+    uint32_t      confidence;
+} rpt_entry_t;
+
+static size_t stride_state_size(const prefetcher_t *pf)
+{
+    return pf->entries * sizeof(rpt_entry_t);
+}
+
+static void stride_init(prefetcher_t *pf)
+{
+}
+
+static int stride_train(prefetcher_t *pf, unsigned int pc, unsigned int address, int outcome,
+                        unsigned int *addresses)
+{
+    rpt_entry_t *entry = &((rpt_entry_t *) pf->state)[(pc >> 2) & (pf->entries - 1)];
+    int32_t stride = (int32_t) (address - entry->last);
+    int i;
+
+    if (entry->pc != pc) {
+        entry->pc = pc;
+        entry->last = address;
+        entry->stride = 0;
+        entry->confidence = 0;
+        return 0;
+    }
+
+    if (stride == entry->stride) {
+        if (entry->confidence < 3)
+            entry->confidence++;
+    }
+    else if (entry->confidence > 0)
+        entry->confidence--;
+    else
+        entry->stride = stride;
+    entry->last = address;
+
+    if (entry->confidence < 2 || entry->stride == 0)
+        return 0;
+    for (i = 0; i < pf->degree; i++)
+        addresses[i] = address + (unsigned int) (entry->stride * (i + 1));
+    return pf->degree;
+}
+
+/************************************************************************************************/
+/* Stream ***************************************************************************************/
+/************************************************************************************************/
+/*
+ * Stream buffers without the buffers: each stream remembers the next block
+ * to fetch and its direction, and keeps degree blocks ahead of any miss or
+ * first use from twice degree blocks behind that block to degree blocks
+ * past it.  A miss no stream covers takes the least recently used one,
+ * heading down if the miss before it was the block above.
+ */
+typedef struct stream_entry
+{
+    uint32_t      next;
+    int32_t       direction;        // +1 or -1, 0 while unused
+    uint32_t      used;
+} stream_entry_t;
+
+typedef struct stream_state
+{
+    uint32_t      last_miss;
+    uint32_t      tick;
+    stream_entry_t stream[];
+} stream_state_t;
+
+static size_t stream_state_size(const prefetcher_t *pf)
+{
+    return sizeof(stream_state_t) + pf->entries * sizeof(stream_entry_t);
+}
+
+static void stream_init(prefetcher_t *pf)
+{
+}
+
+static int stream_train(prefetcher_t *pf, unsigned int pc, unsigned int address, int outcome,
+                        unsigned int *addresses)
+{
+    stream_state_t *state = (stream_state_t *) pf->state;
+    stream_entry_t *s = NULL;
+    uint32_t block = address >> pf->block_bits, target;
+    int32_t behind;
+    int i, n = 0;
+
+    if (outcome == PREFETCH_HIT)
+        return 0;
+    state->tick++;
+
+    for (i = 0; i < pf->entries && s == NULL; i++) {
+        if (state->stream[i].direction == 0)
+            continue;
+        behind = (int32_t) (state->stream[i].next - block) * state->stream[i].direction;
+        if (behind >= -pf->degree && behind <= 2 * pf->degree)
+            s = &state->stream[i];
+    }
+
+    if (s == NULL) {
+        if (outcome != PREFETCH_MISS)
+            return 0;
+        s = &state->stream[0];
+        for (i = 1; i < pf->entries; i++)
+            if (state->stream[i].used < s->used)
+                s = &state->stream[i];
+        s->direction = state->last_miss == block + 1 ? -1 : 1;
+        s->next = block + s->direction;
+    }
+    if (outcome == PREFETCH_MISS)
+        state->last_miss = block;
+    s->used = state->tick;
+
+    // never behind the block just touched, and at most degree past it
+    if ((int32_t) (s->next - block) * s->direction <= 0)
+        s->next = block + s->direction;
+    target = block + s->direction * pf->degree;
+    while (n < pf->degree && (int32_t) (target - s->next) * s->direction >= 0) {
+        addresses[n++] = s->next << pf->block_bits;
+        s->next += s->direction;
+    }
+    return n;
+}
+
+const prefetch_policy_t prefetch_policies[NUM_PREFETCHERS] = {
+    /* state_size,         init,         train */
+    { NULL,                NULL,         NULL         },
+    { next_state_size,     next_init,    next_train   },
+    { stride_state_size,   stride_init,  stride_train },
+    { stream_state_size,   stream_init,  stream_train },
+};
@@ -0,0 +1,149 @@
+/***********************************************************************/
+/***********************************************************************
+ Pipeline Cache Simulator -- per-PC hotspot profile
+ ***********************************************************************/
+/***********************************************************************/
+#include "iplc-internal.h"
+
+#define PROFILE_INITIAL_SIZE 1024
+
+/************************************************************************************************/
+/* Profile Functions ****************************************************************************/
+/************************************************************************************************/
+
+/*
+ * Linear probing on pc + 1, hashed the way the stack distance analysis does.
+ */
+static unsigned int profile_hash(uint32_t key, unsigned int mask)
+{
+    return (key * 2654435761U) & mask;
+}
+
+/*
+ * Returns -1 if memory runs out.
+ */
+int iplc_sim_init_profile(profile_t *p)
+{
+    bzero(p, sizeof(profile_t));
+    p->mask = PROFILE_INITIAL_SIZE - 1;
+    p->keys = (uint32_t *) calloc(PROFILE_INITIAL_SIZE, sizeof(uint32_t));
+    p->entries = (iplc_profile_entry_t *) calloc(PROFILE_INITIAL_SIZE, sizeof(iplc_profile_entry_t));
+    if (!p->keys || !p->entries) {
+        iplc_sim_free_profile(p);
+        return -1;
+    }
+    return 0;
+}
+
+void iplc_sim_free_profile(profile_t *p)
+{
+    free(p->keys);
+    free(p->entries);
+    free(p->sorted);
+    bzero(p, sizeof(profile_t));
+}
+
+/*
+ * Double the table.  Returns -1, leaving it as it was, if memory runs out.
+ */
+static int profile_grow(profile_t *p)
+{
+    unsigned int mask = 2 * p->mask + 1, i, j;
+    uint32_t *keys = (uint32_t *) calloc(mask + 1, sizeof(uint32_t));
+    iplc_profile_entry_t *entries = (iplc_profile_entry_t *) malloc((mask + 1) * sizeof(iplc_profile_entry_t));
+
+    if (!keys || !entries) {
+        free(keys);
+        free(entries);
+        return -1;
+    }
+    for (i = 0; i <= p->mask; i++) {
+        if (p->keys[i] == 0)
+            continue;
+        for (j = profile_hash(p->keys[i], mask); keys[j]; j = (j + 1) & mask)
+            ;
+        keys[j] = p->keys[i];
+        entries[j] = p->entries[i];
+    }
+    free(p->keys);
+    free(p->entries);
+    p->keys = keys;
+    p->entries = entries;
+    p->mask = mask;
+    return 0;
+}
+
+/*
+ * The entry for pc, added if it is new.  Returns NULL only if the table
+ * could not grow and has no room left; the counts are then lost for pc.
+ * Any pointer returned before is stale once a new pc went in.
+ */
+iplc_profile_entry_t *iplc_sim_profile_entry(profile_t *p, unsigned int pc)
+{
+    uint32_t key = pc + 1;
+    unsigned int i;
+
+    for (i = profile_hash(key, p->mask); p->keys[i]; i = (i + 1) & p->mask)
+        if (p->keys[i] == key)
+            return &p->entries[i];
+
+    if (2 * (p->count + 1) > p->mask + 1 && profile_grow(p) == 0)
+        for (i = profile_hash(key, p->mask); p->keys[i]; i = (i + 1) & p->mask)
+            ;
+    if (p->count == p->mask)
+        return NULL;
+
+    p->keys[i] = key;
+    bzero(&p->entries[i], sizeof(iplc_profile_entry_t));
+    p->entries[i].pc = pc;
+    p->count++;
+    return &p->entries[i];
+}
+
+/*
+ * Most stall cycles first, then most misses and mispredicts, then by address.
+ */
+static int profile_order(const void *a, const void *b)
+{
+    const iplc_profile_entry_t *x = (const iplc_profile_entry_t *) a;
+    const iplc_profile_entry_t *y = (const iplc_profile_entry_t *) b;
+    long x_events = x->icache_misses + x->dcache_misses + x->mispredicts;
+    long y_events = y->icache_misses + y->dcache_misses + y->mispredicts;
+
+    if (x->stall_cycles != y->stall_cycles)
+        return x->stall_cycles < y->stall_cycles ? 1 : -1;
+    if (x_events != y_events)
+        return x_events < y_events ? 1 : -1;
+    return x->pc < y->pc ? -1 : x->pc > y->pc;
+}
+
+/*
+ * Hand out every profiled address, hottest first, in an array that stays
+ * valid until the next call or iplc_sim_destroy().  Returns how many there
+ * are: 0 if the simulator was not profiling, -1 if memory runs out.
+ */
+int iplc_sim_profile(iplc_sim_t *sim, const iplc_profile_entry_t **entries)
+{
+    profile_t *p = &sim->profile;
+    iplc_profile_entry_t *e;
+    unsigned int i, n = 0;
+
+    *entries = NULL;
+    if (p->keys == NULL)
+        return 0;
+
+    free(p->sorted);
+    p->sorted = (iplc_profile_entry_t *) malloc((p->count + 1) * sizeof(iplc_profile_entry_t));
+    if (p->sorted == NULL)
+        return -1;
+    for (i = 0; i <= p->mask; i++) {
+        if (p->keys[i] == 0)
+            continue;
+        e = &p->sorted[n++];
+        *e = p->entries[i];
+        e->stall_cycles = e->icache_cycles + e->dcache_cycles + e->hazard_cycles + e->branch_cycles;
+    }
+    qsort(p->sorted, n, sizeof(iplc_profile_entry_t), profile_order);
+    *entries = p->sorted;
+    return (int) n;
+}
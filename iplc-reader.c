@@ -0,0 +1,317 @@
+/***********************************************************************/
+/***********************************************************************
+ Pipeline Cache Simulator -- trace reader thread
+ ***********************************************************************/
+/***********************************************************************/
+#include <pthread.h>
+#include <sched.h>
+
+#include "iplc-internal.h"
+
+/************************************************************************************************/
+/* Reader Functions *****************************************************************************/
+/************************************************************************************************/
+
+/*
+ * A thread that reads and decodes a trace stream ahead of the simulation
+ * into a single producer, single consumer ring.  Each record comes with
+ * the stream offset just past it, which is where a checkpoint taken after
+ * it resumes.  head and tail only grow and sit on lines of their own.
+ */
+#define READER_RING 16384           // records, power of two
+#define READER_BATCH 256            // published and handed out this many at a time
+
+struct trace_reader
+{
+    FILE          *in;
+    uint64_t      skip;             // records to drop before the first one handed out
+    uint64_t      offset;           // of the next record in the stream
+    trace_record_t *records;        // [READER_RING]
+    uint64_t      *ends;            // [READER_RING], stream offset after each record
+    unsigned long tail;             // written by the reader thread
+    char          pad[64 - sizeof(unsigned long)];
+    unsigned long head;             // written by the simulation
+    char          pad2[64 - sizeof(unsigned long)];
+    int           done;             // nothing comes after tail
+    int           failed;           // a read or decode error ended the stream
+    unsigned long taken;            // simulation's end of the batch it holds
+    unsigned long local_tail;       // reader thread's own, ahead of tail
+    unsigned long local_head;       // reader thread's last look at head
+    pthread_t     thread;
+};
+
+/*
+ * Make room for one more record, waiting while the ring is full.  Returns
+ * the slot to fill.
+ */
+static unsigned long reader_slot(trace_reader_t *reader)
+{
+    while (reader->local_tail - reader->local_head == READER_RING) {
+        __atomic_store_n(&reader->tail, reader->local_tail, __ATOMIC_RELEASE);
+        reader->local_head = __atomic_load_n(&reader->head, __ATOMIC_ACQUIRE);
+        if (reader->local_tail - reader->local_head == READER_RING)
+            sched_yield();
+    }
+    return reader->local_tail & (READER_RING - 1);
+}
+
+/*
+ * A record is in its slot: hand it out, unless it is still being skipped.
+ */
+static void reader_commit(trace_reader_t *reader, unsigned long slot)
+{
+    reader->ends[slot] = reader->offset;
+    if (reader->skip) {
+        reader->skip--;
+        return;
+    }
+    reader->local_tail++;
+    if ((reader->local_tail & (READER_BATCH - 1)) == 0)
+        __atomic_store_n(&reader->tail, reader->local_tail, __ATOMIC_RELEASE);
+}
+
+/*
+ * Read a zigzag LEB128 varint from the delta trace.  Returns -1 if the
+ * stream ends or the varint runs past 32 bits.
+ */
+static int reader_varint(trace_reader_t *reader, int32_t *value)
+{
+    uint32_t zigzag = 0;
+    int c, shift;
+
+    for (shift = 0; shift < 35; shift += 7) {
+        if ((c = getc_unlocked(reader->in)) == EOF)
+            return -1;
+        reader->offset++;
+        zigzag |= (uint32_t) (c & 0x7f) << shift;
+        if (!(c & 0x80)) {
+            *value = (int32_t) (zigzag >> 1) ^ -(int32_t) (zigzag & 1);
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/*
+ * The records of a delta trace, each decoded against the addresses of the
+ * one before it.  Returns -1 on a record that is cut short or malformed.
+ */
+static int reader_delta(trace_reader_t *reader, const trace_header_t *header)
+{
+    trace_record_t *rec, last;
+    int32_t delta;
+    uint64_t r;
+    unsigned long slot;
+    unsigned int regs;
+    int tag, low, high;
+
+    bzero(&last, sizeof(last));
+    for (r = 0; r < header->record_count; r++) {
+        slot = reader_slot(reader);
+        rec = &reader->records[slot];
+        bzero(rec, sizeof(trace_record_t));
+        if ((tag = getc_unlocked(reader->in)) == EOF)
+            break;
+        reader->offset++;
+        rec->opcode = tag & 0x0f;
+        rec->instruction_address = last.instruction_address + 4;
+        if (!(tag & DELTA_SEQUENTIAL)) {
+            if (reader_varint(reader, &delta) < 0)
+                break;
+            rec->instruction_address += (uint32_t) delta;
+        }
+        low = getc_unlocked(reader->in);
+        high = getc_unlocked(reader->in);
+        if (low == EOF || high == EOF)
+            break;
+        reader->offset += 2;
+        regs = (unsigned int) (high << 8 | low);
+        if (rec->opcode >= NUM_OPCODES || regs >= 33 * 33 * 33)
+            break;
+        rec->dest_reg = (int8_t) (regs / (33 * 33) - 1);
+        rec->src_reg1 = (int8_t) (regs / 33 % 33 - 1);
+        rec->src_reg2 = (int8_t) (regs % 33 - 1);
+        if (tag & DELTA_DATA) {
+            if (reader_varint(reader, &delta) < 0)
+                break;
+            rec->data_address = last.data_address + (uint32_t) delta;
+            last.data_address = rec->data_address;
+        }
+        if ((tag & DELTA_CONSTANT) && reader_varint(reader, &rec->constant) < 0)
+            break;
+        last.instruction_address = rec->instruction_address;
+        reader_commit(reader, slot);
+    }
+    if (r < header->record_count) {
+        printf("Delta trace record %lu is cut short or malformed \n", (unsigned long) r);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * A binary or delta trace on a stream: the header, then for the binary
+ * format records read straight into the ring.  Returns -1 for a bad
+ * header or a short read.
+ */
+static int reader_binary(trace_reader_t *reader)
+{
+    trace_header_t header;
+    uint64_t r;
+    unsigned long slot;
+
+    if (fread(&header, sizeof(header), 1, reader->in) != 1 || header.version != TRACE_VERSION ||
+        header.record_size != sizeof(trace_record_t) ||
+        (memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) != 0 &&
+         memcmp(header.magic, TRACE_DELTA_MAGIC, sizeof(header.magic)) != 0)) {
+        printf("Bad binary trace header \n");
+        return -1;
+    }
+    reader->offset = sizeof(header);
+    if (memcmp(header.magic, TRACE_DELTA_MAGIC, sizeof(header.magic)) == 0)
+        return reader_delta(reader, &header);
+    for (r = 0; r < header.record_count; r++) {
+        slot = reader_slot(reader);
+        if (fread(&reader->records[slot], sizeof(trace_record_t), 1, reader->in) != 1) {
+            printf("Binary trace ends after %lu of %lu records \n", (unsigned long) r,
+                   (unsigned long) header.record_count);
+            return -1;
+        }
+        if (reader->records[slot].opcode >= NUM_OPCODES) {
+            printf("Bad opcode %d in binary trace record %lu \n", reader->records[slot].opcode, (unsigned long) r);
+            return -1;
+        }
+        reader->offset += sizeof(trace_record_t);
+        reader_commit(reader, slot);
+    }
+    return 0;
+}
+
+/*
+ * A text trace: a line at a time through iplc_sim_decode_instruction().
+ * Returns -1 on a malformed line or a read error.
+ */
+static int reader_text(trace_reader_t *reader)
+{
+    char buffer[80];
+    unsigned long slot;
+
+    while (fgets(buffer, 80, reader->in) != NULL) {
+        slot = reader_slot(reader);
+        if (iplc_sim_decode_instruction(buffer, &reader->records[slot]) < 0)
+            return -1;
+        reader->offset += strlen(buffer);
+        reader_commit(reader, slot);
+    }
+    return ferror(reader->in) ? -1 : 0;
+}
+
+static void *reader_thread(void *arg)
+{
+    trace_reader_t *reader = (trace_reader_t *) arg;
+    int seekable = fseek(reader->in, 0, SEEK_CUR) == 0;
+    int c, failed;
+
+    // binary and delta traces start with their magic, text ones with an address
+    c = getc(reader->in);
+    if (c != EOF)
+        ungetc(c, reader->in);
+    if (c == TRACE_MAGIC[0])
+        failed = reader_binary(reader);
+    else {
+        // a text file goes straight to the checkpoint's offset, a pipe decodes its way there
+        if (reader->skip && seekable && fseek(reader->in, (long) reader->offset, SEEK_SET) == 0)
+            reader->skip = 0;
+        else
+            reader->offset = 0;
+        failed = reader_text(reader);
+    }
+
+    __atomic_store_n(&reader->failed, failed, __ATOMIC_RELAXED);
+    __atomic_store_n(&reader->tail, reader->local_tail, __ATOMIC_RELEASE);
+    __atomic_store_n(&reader->done, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+/*
+ * Start reading in, text, binary or delta, a file or a pipe, on a thread
+ * of its own; a stream from iplc_sim_open_trace() is decompressed there as
+ * well.  The first records records are left out: a text file seeks to
+ * offset for them when it can, anything else reads past them.  Returns
+ * NULL if memory runs out or the thread cannot be started.
+ */
+trace_reader_t *iplc_sim_open_reader(FILE *in, uint64_t records, uint64_t offset)
+{
+    trace_reader_t *reader = (trace_reader_t *) calloc(1, sizeof(trace_reader_t));
+
+    if (reader == NULL)
+        return NULL;
+    reader->in = in;
+    reader->skip = records;
+    reader->offset = offset;
+    reader->records = (trace_record_t *) malloc(READER_RING * sizeof(trace_record_t));
+    reader->ends = (uint64_t *) malloc(READER_RING * sizeof(uint64_t));
+    if (!reader->records || !reader->ends || pthread_create(&reader->thread, NULL, reader_thread, reader) != 0) {
+        free(reader->records);
+        free(reader->ends);
+        free(reader);
+        return NULL;
+    }
+    return reader;
+}
+
+/*
+ * Give back the last batch and wait for the next one: up to READER_BATCH
+ * records in a row, and the stream offset after each.  They stay put until
+ * the next call.  Returns how many there are, 0 at the end of the trace and
+ * -1 once the records before a read or decode error are used up.
+ */
+long iplc_sim_read_batch(trace_reader_t *reader, const trace_record_t **records, const uint64_t **ends)
+{
+    unsigned long head = reader->taken, tail, count;
+
+    __atomic_store_n(&reader->head, head, __ATOMIC_RELEASE);
+    for (;;) {
+        tail = __atomic_load_n(&reader->tail, __ATOMIC_ACQUIRE);
+        if (tail != head)
+            break;
+        if (__atomic_load_n(&reader->done, __ATOMIC_ACQUIRE)) {
+            // done follows the last tail, so look once more
+            if (__atomic_load_n(&reader->tail, __ATOMIC_ACQUIRE) != head)
+                continue;
+            return __atomic_load_n(&reader->failed, __ATOMIC_RELAXED) ? -1 : 0;
+        }
+        sched_yield();
+    }
+
+    // a batch never wraps around the end of the ring
+    count = tail - head;
+    if (count > READER_BATCH)
+        count = READER_BATCH;
+    if (count > READER_RING - (head & (READER_RING - 1)))
+        count = READER_RING - (head & (READER_RING - 1));
+    *records = &reader->records[head & (READER_RING - 1)];
+    if (ends)
+        *ends = &reader->ends[head & (READER_RING - 1)];
+    reader->taken = head + count;
+    return (long) count;
+}
+
+/*
+ * Stop the reader, whether or not the trace was read to the end, and free
+ * it.  The stream stays open.
+ */
+void iplc_sim_close_reader(trace_reader_t *reader)
+{
+    const trace_record_t *records;
+
+    if (reader == NULL)
+        return;
+    // a reader waiting on a full ring needs the rest taken off it
+    while (iplc_sim_read_batch(reader, &records, NULL) > 0)
+        ;
+    pthread_join(reader->thread, NULL);
+    free(reader->records);
+    free(reader->ends);
+    free(reader);
+}
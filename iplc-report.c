@@ -0,0 +1,334 @@
+/***********************************************************************/
+/***********************************************************************
+ Pipeline Cache Simulator -- machine readable results
+ ***********************************************************************/
+/***********************************************************************/
+#include "iplc-internal.h"
+
+const char *output_names[NUM_OUTPUTS] = {
+    "text", "json", "csv"
+};
+
+/*
+ * Look an output format up by its name, -1 if there is no such format.
+ */
+int iplc_sim_output_by_name(const char *name)
+{
+    int i;
+
+    for (i = 0; i < NUM_OUTPUTS; i++)
+        if (strcmp(name, output_names[i]) == 0)
+            return i;
+    return -1;
+}
+
+static double ratio(long part, long whole)
+{
+    return whole ? (double)part / (double)whole : 0.0;
+}
+
+static double prefetch_accuracy(const iplc_prefetch_stats_t *stats)
+{
+    return ratio(stats->useful, stats->issued);
+}
+
+/*
+ * The share of the misses there would have been without the prefetcher
+ * that it removed; late prefetches did not remove theirs.
+ */
+static double prefetch_coverage(const iplc_prefetch_stats_t *stats, long misses)
+{
+    return ratio(stats->useful - stats->late, misses + stats->useful - stats->late);
+}
+
+/************************************************************************************************/
+/* CSV Functions ********************************************************************************/
+/************************************************************************************************/
+
+void iplc_sim_print_csv_header(FILE *out)
+{
+    fprintf(out, "icache_index,icache_blocksize,icache_assoc,icache_policy,"
+            "dcache_index,dcache_blocksize,dcache_assoc,dcache_policy,branch_predict_taken,"
+            "cache_accesses,cache_misses,cache_hits,cache_miss_rate,"
+            "icache_accesses,icache_misses,dcache_accesses,dcache_misses,"
+            "l2_accesses,l2_misses,l3_accesses,l3_misses,memory_accesses,"
+            "cycles,instructions,branches,correct_branch_predictions,predictor,"
+            "direction_mispredict_cycles,btb_mispredict_cycles,ras_mispredict_cycles,"
+            "hazards,load_use_stall_cycles,data_stall_cycles,branch_stall_cycles,"
+            "pipeline_depth,issue_width,cpi,ooo_rob_entries,ooo_cycles,ooo_cpi,ooo_rob_occupancy,"
+            "mshrs,secondary_misses,miss_overlap_cycles,mshr_occupancy,"
+            "write_policy,write_allocate,write_buffer,writebacks,write_bytes,store_stall_cycles,"
+            "writeback_stall_cycles,icache_prefetcher,icache_prefetch_accuracy,icache_prefetch_coverage,"
+            "dcache_prefetcher,dcache_prefetch_accuracy,dcache_prefetch_coverage,"
+            "icache_compulsory,icache_capacity,icache_conflict,dcache_compulsory,dcache_capacity,dcache_conflict,"
+            "intervals,phases,min_interval_cpi,max_interval_cpi,sample_windows,sampled_cpi,sampled_cpi_bound\n");
+}
+
+/*
+ * One row under iplc_sim_print_csv_header().
+ */
+void iplc_sim_print_csv(FILE *out, const iplc_sim_config_t *config, const iplc_sim_stats_t *stats)
+{
+    fprintf(out, "%d,%d,%d,%s,%d,%d,%d,%s,%u,%ld,%ld,%ld,%f,%ld,%ld,%ld,%ld,%ld,%ld,%ld,%ld,%ld,",
+            config->icache.index, config->icache.blocksize, config->icache.assoc,
+            policy_names[config->icache.policy],
+            config->dcache.index, config->dcache.blocksize, config->dcache.assoc,
+            policy_names[config->dcache.policy],
+            config->branch_predict_taken,
+            stats->cache_access, stats->cache_miss, stats->cache_hit,
+            (double)stats->cache_miss / (double)stats->cache_access,
+            stats->icache.access, stats->icache.miss, stats->dcache.access, stats->dcache.miss,
+            stats->l2.access, stats->l2.miss, stats->l3.access, stats->l3.miss, stats->memory_access);
+    // a cache-only run has no pipeline to fill the cycle, branch and hazard cells with
+    if (stats->partitions)
+        fprintf(out, ",%ld,,,,,,,,,,,,,,", stats->instruction_count);
+    else
+        fprintf(out, "%ld,%ld,%ld,%ld,%s,%ld,%ld,%ld,%s,%ld,%ld,%ld,%d,%d,%f,",
+                stats->pipeline_cycles, stats->instruction_count, stats->branch_count,
+                stats->correct_branch_predictions, predictor_names[stats->branch.predictor],
+                stats->branch.direction_cycles, stats->branch.btb_cycles, stats->branch.ras_cycles,
+                hazard_names[stats->hazard.model], stats->hazard.load_use_cycles, stats->hazard.data_cycles,
+                stats->hazard.branch_cycles, stats->pipeline_depth, stats->issue_width,
+                (double)stats->pipeline_cycles / (double)stats->instruction_count);
+    fprintf(out, "%d,%ld,%f,%f,%d,%ld,%ld,%f,%s,%d,%d,%ld,%ld,%ld,%ld,%s,%f,%f,%s,%f,%f,%ld,%ld,%ld,%ld,%ld,%ld,%ld,%d,%f,%f,%ld,%f,%f\n",
+            stats->ooo.rob_entries, stats->ooo.cycles, ratio(stats->ooo.cycles, stats->ooo.instructions),
+            ratio(stats->ooo.rob_occupancy, stats->ooo.cycles), stats->mshr.mshrs, stats->mshr.secondary_misses,
+            stats->mshr.miss_cycles - stats->mshr.wait_cycles - stats->mshr.full_cycles,
+            ratio(stats->mshr.busy_cycles, stats->pipeline_cycles),
+            write_policy_names[config->write_policy], config->write_allocate, config->write_buffer,
+            stats->write.writebacks, stats->write.bytes, stats->write.store_cycles, stats->write.writeback_cycles,
+            prefetcher_names[stats->icache_prefetch.type], prefetch_accuracy(&stats->icache_prefetch),
+            prefetch_coverage(&stats->icache_prefetch, stats->icache.miss),
+            prefetcher_names[stats->dcache_prefetch.type], prefetch_accuracy(&stats->dcache_prefetch),
+            prefetch_coverage(&stats->dcache_prefetch, stats->dcache.miss),
+            stats->icache.compulsory, stats->icache.capacity, stats->icache.conflict,
+            stats->dcache.compulsory, stats->dcache.capacity, stats->dcache.conflict,
+            stats->interval.intervals, stats->interval.phases, stats->interval.min_cpi, stats->interval.max_cpi,
+            stats->sample.windows, stats->sample.cpi, stats->sample.cpi_bound);
+}
+
+/************************************************************************************************/
+/* JSON Functions *******************************************************************************/
+/************************************************************************************************/
+
+static void json_cache_config(FILE *out, const char *name, const iplc_cache_config_t *cache, int lower)
+{
+    fprintf(out, "\"%s\": {\"index\": %d, \"blocksize\": %d, \"assoc\": %d, \"policy\": \"%s\", \"latency\": %d",
+            name, cache->index, cache->blocksize, cache->assoc, policy_names[cache->policy], cache->latency);
+    if (lower)
+        fprintf(out, ", \"inclusion\": \"%s\"", inclusion_names[cache->inclusion]);
+    fprintf(out, "}, ");
+}
+
+static void json_prefetch_config(FILE *out, const char *name, const iplc_prefetch_config_t *pf)
+{
+    fprintf(out, "\"%s\": {\"type\": \"%s\", \"degree\": %d, \"entries\": %d}, ",
+            name, prefetcher_names[pf->type], pf->degree, pf->entries);
+}
+
+static void json_prefetch_stats(FILE *out, const char *name, const iplc_prefetch_stats_t *stats, long misses)
+{
+    fprintf(out, ", \"%s\": {\"issued\": %ld, \"useful\": %ld, \"late\": %ld, \"unused\": %ld, "
+            "\"dropped\": %ld, \"pollution\": %ld, \"accuracy\": %f, \"coverage\": %f, \"timeliness\": %f}",
+            name, stats->issued, stats->useful, stats->late, stats->unused, stats->dropped, stats->pollution,
+            prefetch_accuracy(stats), prefetch_coverage(stats, misses),
+            ratio(stats->useful - stats->late, stats->useful));
+}
+
+static void json_cache_stats(FILE *out, const char *name, const iplc_cache_stats_t *stats, unsigned int classified)
+{
+    fprintf(out, "\"%s\": {\"accesses\": %ld, \"misses\": %ld, \"hits\": %ld, \"miss_rate\": %f",
+            name, stats->access, stats->miss, stats->hit, ratio(stats->miss, stats->access));
+    if (classified)
+        fprintf(out, ", \"compulsory\": %ld, \"capacity\": %ld, \"conflict\": %ld",
+                stats->compulsory, stats->capacity, stats->conflict);
+    fprintf(out, "}, ");
+}
+
+/*
+ * The cycle, branch and hazard members, which only a run with the pipeline
+ * has.
+ */
+static void json_pipeline_stats(FILE *out, const iplc_sim_stats_t *stats)
+{
+    const iplc_branch_stats_t *branch = &stats->branch;
+
+    fprintf(out, "\"memory_accesses\": %ld, \"cycles\": %ld, \"instructions\": %ld, \"branches\": %ld, "
+            "\"correct_branch_predictions\": %ld, \"cpi\": %f, ",
+            stats->memory_access, stats->pipeline_cycles, stats->instruction_count, stats->branch_count,
+            stats->correct_branch_predictions, ratio(stats->pipeline_cycles, stats->instruction_count));
+    fprintf(out, "\"branch\": {\"predictions\": %ld, \"correct\": %ld, \"bimodal_correct\": %ld, "
+            "\"gshare_correct\": %ld, \"chooser_gshare\": %ld, \"btb_lookups\": %ld, \"btb_hits\": %ld, "
+            "\"ras_predictions\": %ld, \"ras_correct\": %ld, \"direction_mispredict_cycles\": %ld, "
+            "\"btb_mispredict_cycles\": %ld, \"ras_mispredict_cycles\": %ld}, ",
+            branch->predictions, branch->correct, branch->bimodal_correct, branch->gshare_correct,
+            branch->chooser_gshare, branch->btb_lookups, branch->btb_hits, branch->ras_predictions,
+            branch->ras_correct, branch->direction_cycles, branch->btb_cycles, branch->ras_cycles);
+    fprintf(out, "\"hazard\": {\"load_use_stall_cycles\": %ld, \"data_stall_cycles\": %ld, "
+            "\"branch_stall_cycles\": %ld, \"exmem_forwards\": %ld, \"memwb_forwards\": %ld}",
+            stats->hazard.load_use_cycles, stats->hazard.data_cycles, stats->hazard.branch_cycles,
+            stats->hazard.exmem_forwards, stats->hazard.memwb_forwards);
+}
+
+/*
+ * One run as a single line JSON object with "config" and "stats" members.
+ * Lower levels only appear when config has them.
+ */
+void iplc_sim_print_json(FILE *out, const iplc_sim_config_t *config, const iplc_sim_stats_t *stats)
+{
+    fprintf(out, "{\"config\": {");
+    json_cache_config(out, "icache", &config->icache, 0);
+    json_cache_config(out, "dcache", &config->dcache, 0);
+    if (config->levels > 1)
+        json_cache_config(out, "l2", &config->l2, 1);
+    if (config->levels > 2)
+        json_cache_config(out, "l3", &config->l3, 1);
+    json_prefetch_config(out, "icache_prefetch", &config->icache_prefetch);
+    json_prefetch_config(out, "dcache_prefetch", &config->dcache_prefetch);
+    fprintf(out, "\"levels\": %d, \"memory_latency\": %d, \"seed\": %u, \"classify_misses\": %u, ",
+            config->levels, config->memory_latency, config->seed, config->classify_misses);
+    fprintf(out, "\"interval\": %d, \"interval_unit\": \"%s\", \"bbv_dims\": %d, ",
+            config->interval, interval_unit_names[config->interval_unit], config->bbv_dims);
+    fprintf(out, "\"sample_window\": %ld, \"sample_warmup\": %ld, \"sample_period\": %ld, \"simpoints\": %d, ",
+            config->sample_window, config->sample_warmup, config->sample_period, config->num_simpoints);
+    fprintf(out, "\"predictor\": \"%s\", \"branch_predict_taken\": %u, \"bp_table_bits\": %d, "
+            "\"bp_history_bits\": %d, \"bp_chooser_bits\": %d, \"btb_entries\": %d, \"ras_depth\": %d, "
+            "\"hazards\": \"%s\", \"pipeline_depth\": %d, \"issue_width\": %d, \"rob_entries\": %d, "
+            "\"iq_entries\": %d, \"lsq_entries\": %d, \"mshrs\": %d, \"write_policy\": \"%s\", "
+            "\"write_allocate\": %d, \"write_buffer\": %d}, ",
+            predictor_names[config->predictor], config->branch_predict_taken, config->bp_table_bits,
+            config->bp_history_bits, config->bp_chooser_bits, config->btb_entries, config->ras_depth,
+            hazard_names[config->hazards], config->pipeline_depth, config->issue_width, config->rob_entries,
+            config->iq_entries, config->lsq_entries, config->mshrs, write_policy_names[config->write_policy],
+            config->write_allocate, config->write_buffer);
+
+    fprintf(out, "\"stats\": {\"cache_accesses\": %ld, \"cache_misses\": %ld, \"cache_hits\": %ld, "
+            "\"cache_miss_rate\": %f, ",
+            stats->cache_access, stats->cache_miss, stats->cache_hit,
+            ratio(stats->cache_miss, stats->cache_access));
+    json_cache_stats(out, "icache", &stats->icache, stats->classified);
+    json_cache_stats(out, "dcache", &stats->dcache, stats->classified);
+    if (stats->levels > 1)
+        json_cache_stats(out, "l2", &stats->l2, stats->classified);
+    if (stats->levels > 2)
+        json_cache_stats(out, "l3", &stats->l3, stats->classified);
+    // a cache-only run has no pipeline, so no cycles, branches or hazards
+    if (stats->partitions)
+        fprintf(out, "\"memory_accesses\": %ld, \"instructions\": %ld",
+                stats->memory_access, stats->instruction_count);
+    else
+        json_pipeline_stats(out, stats);
+    if (stats->icache_prefetch.type != PREFETCH_NONE)
+        json_prefetch_stats(out, "icache_prefetch", &stats->icache_prefetch, stats->icache.miss);
+    if (stats->dcache_prefetch.type != PREFETCH_NONE)
+        json_prefetch_stats(out, "dcache_prefetch", &stats->dcache_prefetch, stats->dcache.miss);
+    if (stats->write.policy != WRITE_OFF)
+        fprintf(out, ", \"write\": {\"stores\": %ld, \"store_misses\": %ld, \"writebacks\": %ld, "
+                "\"writes\": %ld, \"coalesced\": %ld, \"bytes\": %ld, \"store_stall_cycles\": %ld, "
+                "\"writeback_stall_cycles\": %ld, \"buffer_full_cycles\": %ld}",
+                stats->write.stores, stats->write.store_misses, stats->write.writebacks, stats->write.writes,
+                stats->write.coalesced, stats->write.bytes, stats->write.store_cycles,
+                stats->write.writeback_cycles, stats->write.buffer_full_cycles);
+    if (stats->mshr.mshrs)
+        fprintf(out, ", \"mshr\": {\"mshrs\": %d, \"primary_misses\": %ld, \"secondary_misses\": %ld, "
+                "\"miss_cycles\": %ld, \"wait_cycles\": %ld, \"full_cycles\": %ld, \"occupancy\": %f, "
+                "\"memory_level_parallelism\": %f}",
+                stats->mshr.mshrs, stats->mshr.primary_misses, stats->mshr.secondary_misses,
+                stats->mshr.miss_cycles, stats->mshr.wait_cycles, stats->mshr.full_cycles,
+                ratio(stats->mshr.busy_cycles, stats->pipeline_cycles),
+                ratio(stats->mshr.busy_cycles, stats->mshr.active_cycles));
+    if (stats->ooo.rob_entries)
+        fprintf(out, ", \"ooo\": {\"rob_entries\": %d, \"iq_entries\": %d, \"lsq_entries\": %d, "
+                "\"cycles\": %ld, \"cpi\": %f, \"rob_occupancy\": %f, \"rob_full_cycles\": %ld, "
+                "\"iq_full_cycles\": %ld, \"lsq_full_cycles\": %ld, \"fetch_stall_cycles\": %ld}",
+                stats->ooo.rob_entries, stats->ooo.iq_entries, stats->ooo.lsq_entries, stats->ooo.cycles,
+                ratio(stats->ooo.cycles, stats->ooo.instructions), ratio(stats->ooo.rob_occupancy, stats->ooo.cycles),
+                stats->ooo.rob_full_cycles, stats->ooo.iq_full_cycles, stats->ooo.lsq_full_cycles,
+                stats->ooo.fetch_stall_cycles);
+    if (stats->interval.length)
+        fprintf(out, ", \"interval\": {\"intervals\": %ld, \"phases\": %d, \"min_cpi\": %f, \"max_cpi\": %f}",
+                stats->interval.intervals, stats->interval.phases, stats->interval.min_cpi,
+                stats->interval.max_cpi);
+    if (stats->sample.window)
+        fprintf(out, ", \"sample\": {\"windows\": %ld, \"instructions\": %ld, \"detailed_instructions\": %ld, "
+                "\"cpi\": %f, \"cpi_bound\": %f, \"estimated_cycles\": %.0f}",
+                stats->sample.windows, stats->sample.instructions, stats->sample.detailed_instructions,
+                stats->sample.cpi, stats->sample.cpi_bound, stats->sample.estimated_cycles);
+    if (stats->partitions)
+        fprintf(out, ", \"cache_only\": {\"partitions\": %d}", stats->partitions);
+    fprintf(out, "}}");
+}
+
+/************************************************************************************************/
+/* Report Functions *****************************************************************************/
+/************************************************************************************************/
+
+/*
+ * Print the results of count runs in format: text blocks one after the
+ * other, a CSV table, or a JSON array in run order.
+ */
+void iplc_sim_print_results(FILE *out, int format, const iplc_sim_config_t *configs,
+                            const iplc_sim_stats_t *stats, int count)
+{
+    int i;
+
+    if (format == OUTPUT_CSV)
+        iplc_sim_print_csv_header(out);
+    if (format == OUTPUT_JSON)
+        fprintf(out, "[");
+
+    for (i = 0; i < count; i++) {
+        switch (format) {
+            case OUTPUT_CSV:
+                iplc_sim_print_csv(out, &configs[i], &stats[i]);
+                break;
+            case OUTPUT_JSON:
+                fprintf(out, i ? ",\n " : "\n ");
+                iplc_sim_print_json(out, &configs[i], &stats[i]);
+                break;
+            default:
+                fprintf(out, "Job %d \n", i + 1);
+                iplc_sim_print_stats(out, &stats[i]);
+                break;
+        }
+    }
+
+    if (format == OUTPUT_JSON)
+        fprintf(out, "\n]\n");
+}
+
+/************************************************************************************************/
+/* Profile Export *******************************************************************************/
+/************************************************************************************************/
+
+/*
+ * Every address from iplc_sim_profile(), as a CSV table or as folded
+ * stacks (address;cause cycles, one line per cause that cost anything)
+ * ready for flamegraph.pl.
+ */
+void iplc_sim_export_profile(FILE *out, const iplc_profile_entry_t *entries, int count, int folded)
+{
+    static const char *causes[4] = { "icache", "dcache", "hazard", "branch" };
+    long cycles[4];
+    int i, k;
+
+    if (!folded)
+        fprintf(out, "pc,instructions,icache_misses,dcache_misses,mispredicts,"
+                "icache_cycles,dcache_cycles,hazard_cycles,branch_cycles,stall_cycles\n");
+    for (i = 0; i < count; i++) {
+        if (!folded) {
+            fprintf(out, "0x%08x,%ld,%ld,%ld,%ld,%ld,%ld,%ld,%ld,%ld\n", entries[i].pc,
+                    entries[i].instructions, entries[i].icache_misses, entries[i].dcache_misses,
+                    entries[i].mispredicts, entries[i].icache_cycles, entries[i].dcache_cycles,
+                    entries[i].hazard_cycles, entries[i].branch_cycles, entries[i].stall_cycles);
+            continue;
+        }
+        cycles[0] = entries[i].icache_cycles;
+        cycles[1] = entries[i].dcache_cycles;
+        cycles[2] = entries[i].hazard_cycles;
+        cycles[3] = entries[i].branch_cycles;
+        for (k = 0; k < 4; k++)
+            if (cycles[k])
+                fprintf(out, "0x%08x;%s %ld\n", entries[i].pc, causes[k], cycles[k]);
+    }
+}
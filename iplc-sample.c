@@ -0,0 +1,298 @@
+/***********************************************************************/
+/***********************************************************************
+ Pipeline Cache Simulator -- sampled simulation
+ ***********************************************************************/
+/***********************************************************************/
+#include "iplc-internal.h"
+
+/************************************************************************************************/
+/* SimPoint Files *******************************************************************************/
+/************************************************************************************************/
+
+/*
+ * Read the next two numbers off a line of f, skipping blank lines and
+ * # comments.  Returns 1 for a pair, 0 at the end of the file and -1 for
+ * a line that is not a pair.
+ */
+static int read_pair(FILE *f, double *a, double *b)
+{
+    char buffer[256], *p;
+
+    while (fgets(buffer, sizeof(buffer), f) != NULL) {
+        for (p = buffer; *p == ' ' || *p == '\t'; p++)
+            ;
+        if (*p == '#' || *p == '\n' || *p == '\0')
+            continue;
+        return sscanf(p, "%lf %lf", a, b) == 2 ? 1 : -1;
+    }
+    return 0;
+}
+
+/*
+ * Load SimPoints from file_name.  Without weights_file_name every line is
+ * "interval weight"; with it they are SimPoint's own output, "interval
+ * cluster" lines and a weights file of "weight cluster" lines.  Returns
+ * how many there are, or -1 after saying what is wrong with the files.
+ */
+int iplc_sim_load_simpoints(const char *file_name, const char *weights_file_name, iplc_simpoint_t **simpoints)
+{
+    FILE *f = NULL, *w = NULL;
+    iplc_simpoint_t *points = NULL, *grown;
+    double *weights = NULL, *grown_weights, a, b;
+    int count = 0, size = 0, clusters = 0, r, i;
+
+    *simpoints = NULL;
+    if (weights_file_name) {
+        w = fopen(weights_file_name, "r");
+        if (w == NULL) {
+            printf("fopen failed for %s file\n", weights_file_name);
+            return -1;
+        }
+        while ((r = read_pair(w, &a, &b)) > 0) {
+            if (b < 0 || b > 65535) {
+                r = -1;
+                break;
+            }
+            for (; clusters <= (int) b; clusters++) {
+                grown_weights = (double *) realloc(weights, (clusters + 1) * sizeof(double));
+                if (grown_weights == NULL) {
+                    r = -1;
+                    break;
+                }
+                weights = grown_weights;
+                weights[clusters] = 0.0;
+            }
+            if (r < 0)
+                break;
+            weights[(int) b] = a;
+        }
+        fclose(w);
+        if (r < 0) {
+            printf("Bad weights line in %s \n", weights_file_name);
+            free(weights);
+            return -1;
+        }
+    }
+
+    f = fopen(file_name, "r");
+    if (f == NULL) {
+        printf("fopen failed for %s file\n", file_name);
+        free(weights);
+        return -1;
+    }
+    while ((r = read_pair(f, &a, &b)) > 0) {
+        if (a < 0 || (weights && (b < 0 || (int) b >= clusters)) || (!weights && b < 0)) {
+            r = -1;
+            break;
+        }
+        if (count == size) {
+            size = size ? 2 * size : 16;
+            grown = (iplc_simpoint_t *) realloc(points, size * sizeof(iplc_simpoint_t));
+            if (grown == NULL) {
+                r = -1;
+                break;
+            }
+            points = grown;
+        }
+        points[count].interval = (long) a;
+        points[count].weight = weights ? weights[(int) b] : b;
+        count++;
+    }
+    fclose(f);
+    free(weights);
+    if (r < 0 || count == 0) {
+        printf("%s in %s \n", r < 0 ? "Bad simpoint line" : "No simpoints", file_name);
+        free(points);
+        return -1;
+    }
+    for (i = 0; i < count; i++)
+        if (points[i].weight > 0)
+            break;
+    if (i == count) {
+        printf("Simpoint weights in %s are all 0 \n", weights_file_name ? weights_file_name : file_name);
+        free(points);
+        return -1;
+    }
+    *simpoints = points;
+    return count;
+}
+
+/************************************************************************************************/
+/* Sampling Functions ***************************************************************************/
+/************************************************************************************************/
+
+static int simpoint_order(const void *a, const void *b)
+{
+    const iplc_simpoint_t *x = (const iplc_simpoint_t *) a;
+    const iplc_simpoint_t *y = (const iplc_simpoint_t *) b;
+
+    return x->interval < y->interval ? -1 : x->interval > y->interval;
+}
+
+/*
+ * Set the sampler up from config, with a sorted copy of its simpoints.
+ * Returns -1 if memory runs out.
+ */
+int iplc_sim_init_sampling(iplc_sim_t *sim, const iplc_sim_config_t *config)
+{
+    sampler_t *s = &sim->sampler;
+
+    if (config->sample_window == 0)
+        return 0;
+
+    s->window = s->stats.window = config->sample_window;
+    s->warmup = s->stats.warmup = config->sample_warmup;
+    s->period = s->stats.period = config->sample_period;
+    s->stats.simpoints = config->num_simpoints;
+    if (config->num_simpoints) {
+        s->simpoints = (iplc_simpoint_t *) malloc(config->num_simpoints * sizeof(iplc_simpoint_t));
+        if (s->simpoints == NULL)
+            return -1;
+        memcpy(s->simpoints, config->simpoints, config->num_simpoints * sizeof(iplc_simpoint_t));
+        qsort(s->simpoints, config->num_simpoints, sizeof(iplc_simpoint_t), simpoint_order);
+        s->num_simpoints = config->num_simpoints;
+    }
+    return 0;
+}
+
+void iplc_sim_free_sampling(iplc_sim_t *sim)
+{
+    free(sim->sampler.simpoints);
+    bzero(&sim->sampler, sizeof(sampler_t));
+}
+
+/*
+ * What to do with the instruction at position n.  With a period each one
+ * ends in warmup and then window detailed instructions; otherwise each
+ * simpoint's window is measured after warmup.  Sets the window and its
+ * weight for SAMPLE_MEASURE.
+ */
+static int sample_mode(sampler_t *s, long n, long *window_id, double *weight)
+{
+    long start, offset;
+
+    if (s->period) {
+        offset = n % s->period;
+        *window_id = n / s->period;
+        *weight = 1.0;
+        if (offset >= s->period - s->window)
+            return SAMPLE_MEASURE;
+        return offset >= s->period - s->window - s->warmup ? SAMPLE_WARMUP : SAMPLE_FAST;
+    }
+
+    while (s->next < s->num_simpoints && (s->simpoints[s->next].interval + 1) * s->window <= n)
+        s->next++;
+    if (s->next == s->num_simpoints)
+        return SAMPLE_FAST;
+    start = s->simpoints[s->next].interval * s->window;
+    *window_id = s->next;
+    *weight = s->simpoints[s->next].weight;
+    if (n >= start)
+        return SAMPLE_MEASURE;
+    return n >= start - s->warmup ? SAMPLE_WARMUP : SAMPLE_FAST;
+}
+
+/*
+ * The window being measured is over: its CPI goes into the sums.
+ */
+static void sample_close(iplc_sim_t *sim)
+{
+    sampler_t *s = &sim->sampler;
+    long instructions = sim->instruction_count - s->start_instructions;
+    double cpi;
+
+    s->measuring = 0;
+    if (instructions == 0 || s->weight <= 0)
+        return;
+    cpi = (double) (sim->pipeline_cycles - s->start_cycles) / (double) instructions;
+    s->sum_w += s->weight;
+    s->sum_w2 += s->weight * s->weight;
+    s->sum_wx += s->weight * cpi;
+    s->sum_wx2 += s->weight * cpi * cpi;
+    s->stats.windows++;
+}
+
+/*
+ * Fast-forward one instruction: the previous control instruction learns
+ * where it went, and the fetch and any data access warm the caches.
+ */
+static void sample_fast_forward(iplc_sim_t *sim, const trace_record_t *rec)
+{
+    sampler_t *s = &sim->sampler;
+
+    if (sim->last_opcode == OP_BEQ || sim->last_opcode == OP_JAL || sim->last_opcode == OP_JR)
+        iplc_sim_predict(&sim->bp, sim->last_opcode, s->last_pc, rec->instruction_address);
+    sim->last_opcode = rec->opcode;
+    s->last_pc = rec->instruction_address;
+
+    iplc_sim_warm_address(sim, &sim->icache, rec->instruction_address, 0);
+    if (rec->opcode == OP_LW || rec->opcode == OP_SW)
+        iplc_sim_warm_address(sim, &sim->dcache, rec->data_address, rec->opcode == OP_SW);
+}
+
+/*
+ * Decide what happens to rec.  A measured window opens and closes on the
+ * pipeline's cycle and retired instruction counts; the pipeline drains
+ * before fast-forwarding starts and picks up where it left off after.
+ * Returns 1 if rec was fast-forwarded, 0 if it goes down the pipeline.
+ */
+int iplc_sim_sample_step(iplc_sim_t *sim, const trace_record_t *rec)
+{
+    sampler_t *s = &sim->sampler;
+    long window_id = 0;
+    double weight = 0.0;
+    int mode = sample_mode(s, s->position++, &window_id, &weight);
+
+    s->stats.instructions++;
+    if (s->measuring && (mode != SAMPLE_MEASURE || window_id != s->window_id))
+        sample_close(sim);
+    if (mode == SAMPLE_MEASURE && !s->measuring) {
+        s->measuring = 1;
+        s->window_id = window_id;
+        s->weight = weight;
+        s->start_cycles = sim->pipeline_cycles;
+        s->start_instructions = sim->instruction_count;
+    }
+
+    if (mode == SAMPLE_FAST) {
+        if (s->detailed) {
+            iplc_sim_drain_pipeline(sim);
+            s->detailed = 0;
+        }
+        sample_fast_forward(sim, rec);
+        return 1;
+    }
+
+    // a control instruction fast-forwarded last is settled here, not in FETCH
+    if (!s->detailed) {
+        if (sim->last_opcode == OP_BEQ || sim->last_opcode == OP_JAL || sim->last_opcode == OP_JR)
+            iplc_sim_predict(&sim->bp, sim->last_opcode, s->last_pc, rec->instruction_address);
+        sim->last_opcode = OP_NOP;
+        s->detailed = 1;
+    }
+    s->stats.detailed_instructions++;
+    return 0;
+}
+
+/*
+ * Close any open window and extrapolate: the weighted mean CPI, and a 95%
+ * confidence bound from the weighted variance over the effective number
+ * of windows.
+ */
+void iplc_sim_finish_sampling(iplc_sim_t *sim)
+{
+    sampler_t *s = &sim->sampler;
+    double variance, n;
+
+    if (s->measuring)
+        sample_close(sim);
+    if (s->sum_w <= 0)
+        return;
+
+    s->stats.cpi = s->sum_wx / s->sum_w;
+    variance = s->sum_wx2 / s->sum_w - s->stats.cpi * s->stats.cpi;
+    n = s->sum_w * s->sum_w / s->sum_w2;
+    if (s->stats.windows > 1 && variance > 0 && n > 1)
+        s->stats.cpi_bound = 1.96 * sqrt(variance * n / (n - 1)) / sqrt(n);
+    s->stats.estimated_cycles = s->stats.cpi * (double) s->stats.instructions;
+}
@@ -0,0 +1,667 @@
+/***********************************************************************/
+/***********************************************************************
+ Pipeline Cache Simulator Library
+ ***********************************************************************/
+/***********************************************************************/
+#ifndef IPLC_SIM_H
+#define IPLC_SIM_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define MAX_CACHE_SIZE 10240      // L1 caches only
+#define MAX_CACHE_LEVELS 3
+#define MAX_PIPELINE_DEPTH 16
+#define MAX_ISSUE_WIDTH 4
+#define MAX_MSHRS 64
+#define MAX_WRITE_BUFFER 64
+#define MAX_PREFETCH_DEGREE 8
+#define MAX_BBV_DIMS 1024
+
+/*
+ * Opcodes understood by the trace decoder.  The text parser maps each
+ * mnemonic onto one of these so the hot path never has to look at strings.
+ */
+enum opcode {OP_NOP, OP_ADD, OP_ADDI, OP_ADDIU, OP_ADDU, OP_SLL, OP_ORI, OP_LUI,
+             OP_LW, OP_SW, OP_BEQ, OP_J, OP_JAL, OP_JR, OP_SYSCALL, NUM_OPCODES};
+
+extern const char *opcode_names[NUM_OPCODES];
+
+/*
+ * Cache replacement policies, picked per simulator in the config.
+ */
+enum replacement_policy {POLICY_LRU, POLICY_PLRU, POLICY_SRRIP, POLICY_BRRIP, POLICY_FIFO,
+                         POLICY_RANDOM, NUM_POLICIES};
+
+extern const char *policy_names[NUM_POLICIES];
+
+/*
+ * How an L2 or L3 relates to the levels above it.  An inclusive level holds
+ * everything above it and invalidates upper copies of what it evicts; an
+ * exclusive level only holds what the levels above have evicted; NINE
+ * (non-inclusive non-exclusive) fills on a miss and never invalidates.
+ */
+enum inclusion_policy {INCLUSION_NINE, INCLUSION_INCLUSIVE, INCLUSION_EXCLUSIVE, NUM_INCLUSIONS};
+
+extern const char *inclusion_names[NUM_INCLUSIONS];
+
+/*
+ * What a sw does in the D-cache.  off treats it like a lw and sends nothing
+ * below the D-cache, as the original simulator did; back marks the block
+ * dirty and writes it back once it is evicted; through sends every store
+ * on to the next level as well.
+ */
+enum write_policy {WRITE_OFF, WRITE_BACK, WRITE_THROUGH, NUM_WRITE_POLICIES};
+
+extern const char *write_policy_names[NUM_WRITE_POLICIES];
+
+/*
+ * Hardware prefetchers for the L1 caches.  next fetches the next degree
+ * blocks after a miss or the first use of a prefetched block; stride keeps
+ * a reference prediction table of entries indexed by PC and runs degree
+ * strides ahead of a lw or sw once its stride repeats; stream follows up to
+ * entries ascending or descending miss streams, degree blocks ahead.
+ */
+enum prefetcher_type {PREFETCH_NONE, PREFETCH_NEXT, PREFETCH_STRIDE, PREFETCH_STREAM, NUM_PREFETCHERS};
+
+extern const char *prefetcher_names[NUM_PREFETCHERS];
+
+/*
+ * What interval statistics are measured in: retired instructions or cycles.
+ */
+enum interval_unit {INTERVAL_INSTRUCTIONS, INTERVAL_CYCLES, NUM_INTERVAL_UNITS};
+
+extern const char *interval_unit_names[NUM_INTERVAL_UNITS];
+
+/*
+ * Direction predictors for beq.  static always predicts
+ * branch_predict_taken; the others use 2-bit counters indexed by PC
+ * (bimodal), PC xor global history (gshare), or both with a per-PC chooser
+ * between them (tournament).
+ */
+enum branch_predictor_type {PREDICTOR_STATIC, PREDICTOR_BIMODAL, PREDICTOR_GSHARE, PREDICTOR_TOURNAMENT,
+                            NUM_PREDICTORS};
+
+extern const char *predictor_names[NUM_PREDICTORS];
+
+/*
+ * How results are printed: the human readable report, one JSON object per
+ * run, or one CSV row per run.
+ */
+enum output_format {OUTPUT_TEXT, OUTPUT_JSON, OUTPUT_CSV, NUM_OUTPUTS};
+
+extern const char *output_names[NUM_OUTPUTS];
+
+/*
+ * How data hazards are handled.  off charges nothing for them, as the
+ * original simulator did; stall has no forwarding, so a consumer waits in
+ * decode until its producer has written back; forward adds EX/MEM and
+ * MEM/WB forwarding so only load-use and branch operand hazards stall.
+ */
+enum hazard_model {HAZARDS_OFF, HAZARDS_STALL, HAZARDS_FORWARD, NUM_HAZARD_MODELS};
+
+extern const char *hazard_names[NUM_HAZARD_MODELS];
+
+/*
+ * Event tracing categories for config.events.  iplc_sim_event_level() gives
+ * the usual sets: 0 nothing, 1 the cache configuration and every hit/miss,
+ * 2 also the tag and index of every access, 3 also the pipeline after every
+ * instruction (the default), 4 also every retired instruction.  Build with
+ * -DIPLC_NO_EVENTS to compile tracing out of the simulator altogether.
+ */
+enum event_category {EVENT_CONFIG = 0x01, EVENT_ADDRESS = 0x02, EVENT_FETCH = 0x04, EVENT_DATA = 0x08,
+                     EVENT_LOWER = 0x10, EVENT_PIPELINE = 0x20, EVENT_RETIRE = 0x40};
+
+#define NUM_EVENT_CATEGORIES 7
+
+extern const char *event_category_names[NUM_EVENT_CATEGORIES];
+
+/*
+ * Binary event format: an event_header_t followed by fixed width
+ * event_record_t entries up to the end of the file, in host byte order.
+ * iplc_sim_decode_events() turns them back into the text the simulator
+ * prints when no event file is given.
+ *   ADDRESS:  a = address, b = tag, c = index
+ *   FETCH:    flag = hit, a = address
+ *   LW / SW:  flag = hit, a = data address
+ *   LOWER:    flag = hit, a = address, b = level (2 or 3)
+ *   STAGE:    flag = role (0 fetch, 1 decode, 2 ALU, 3 MEM, 4 writeback), itype,
+ *             a = instruction address, b = cycle, c = stage << 16 | issue width << 8 | slot
+ *   RETIRE:   itype, a = instruction address, b = cycle
+ *   CONFIG:   flag = cache (0 I-Cache, 1 D-Cache, 2 L2, 3 L3), itype = inclusion << 8 | policy
+ *             (0xff for none), a = index << 24 | block offset bits << 16 | assoc,
+ *             b = blocksize, c = latency
+ */
+#define EVENT_MAGIC "IPLCEVT"
+#define EVENT_VERSION 3
+
+enum event_type {EVENT_TYPE_ADDRESS, EVENT_TYPE_FETCH, EVENT_TYPE_LW, EVENT_TYPE_SW, EVENT_TYPE_LOWER,
+                 EVENT_TYPE_STAGE, EVENT_TYPE_RETIRE, EVENT_TYPE_CONFIG, NUM_EVENT_TYPES};
+
+typedef struct event_header
+{
+    char     magic[8];
+    uint32_t version;
+    uint32_t record_size;
+} event_header_t;
+
+typedef struct event_record
+{
+    uint8_t  type;                     // enum event_type
+    uint8_t  flag;
+    uint16_t itype;
+    uint32_t a;
+    uint32_t b;
+    uint32_t c;
+} event_record_t;
+
+/*
+ * Binary interval format: an interval_header_t, then for every interval an
+ * interval_record_t followed by bbv_dims uint32_t basic block vector
+ * counts, in host byte order.  The counts are instructions fetched in the
+ * basic blocks hashed onto each dimension.  phase is -1 without a BBV.
+ */
+#define INTERVAL_MAGIC "IPLCIVL"
+#define INTERVAL_VERSION 1
+
+typedef struct interval_header
+{
+    char     magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    uint32_t unit;                     // enum interval_unit
+    uint32_t length;
+    uint32_t bbv_dims;
+    uint32_t reserved;
+} interval_header_t;
+
+typedef struct interval_record
+{
+    uint32_t index;
+    int32_t  phase;
+    uint32_t instructions;
+    uint32_t cycles;
+    uint32_t icache_accesses;
+    uint32_t icache_misses;
+    uint32_t dcache_accesses;
+    uint32_t dcache_misses;
+    uint32_t branches;
+    uint32_t correct_branches;
+} interval_record_t;
+
+/*
+ * Checkpoint format: a checkpoint_header_t, then blobs of a uint64_t size
+ * and that many bytes padded to 8, in host byte order.  The first blob is
+ * the simulator itself and the rest are the tables it allocated, so a
+ * checkpoint only restores into the same build of the simulator under the
+ * same configuration.  records and offset are where the trace was: records
+ * stepped, and the byte offset into a text trace.
+ */
+#define CHECKPOINT_MAGIC "IPLCCKP"
+#define CHECKPOINT_VERSION 1
+
+typedef struct checkpoint_header
+{
+    char     magic[8];
+    uint32_t version;
+    uint32_t sim_size;                 // sizeof the simulator state
+    uint64_t records;
+    uint64_t offset;
+} checkpoint_header_t;
+
+/*
+ * Binary trace format: a trace_header_t followed by record_count fixed
+ * width trace_record_t entries, in host byte order.  Registers that an
+ * instruction does not use are stored as -1.
+ *   RTYPE:    dest_reg, src_reg1, src_reg2 (or -1 and the immediate in constant)
+ *   lw:       dest_reg, src_reg1 = base, constant = offset
+ *   sw:       src_reg1 = value, src_reg2 = base, constant = offset
+ *   beq:      src_reg1, src_reg2, constant = offset
+ *   j / jal:  constant = target
+ *   jr:       src_reg1
+ */
+#define TRACE_MAGIC "IPLCTRC"
+#define TRACE_VERSION 1
+
+/*
+ * Delta trace format: the same header with TRACE_DELTA_MAGIC and
+ * record_size still sizeof(trace_record_t), then one variable length
+ * record each.  A tag byte holds the opcode in its low four bits plus
+ * enum delta_flag.  An address that is not 4 past the last one follows as
+ * a zigzag LEB128 varint of its distance from there; then the registers as
+ * a little endian uint16_t, ((dest_reg + 1) * 33 + src_reg1 + 1) * 33 +
+ * src_reg2 + 1; then the data address as a zigzag varint of its distance
+ * from the last one, and the constant as a zigzag varint.
+ */
+#define TRACE_DELTA_MAGIC "IPLCTRD"
+
+enum delta_flag {DELTA_SEQUENTIAL = 0x10, DELTA_DATA = 0x20, DELTA_CONSTANT = 0x40};
+
+typedef struct trace_header
+{
+    char     magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    uint64_t record_count;
+    uint64_t reserved;
+} trace_header_t;
+
+typedef struct trace_record
+{
+    uint32_t instruction_address;
+    uint32_t data_address;
+    int32_t  constant;
+    uint8_t  opcode;
+    int8_t   dest_reg;
+    int8_t   src_reg1;
+    int8_t   src_reg2;
+} trace_record_t;
+
+/*
+ * A whole trace held in memory: either a read-only mapping of a binary
+ * trace or a private array decoded from a text trace.
+ */
+typedef struct trace
+{
+    const trace_record_t *records;
+    unsigned long        count;
+    void                 *map;        // whole mapping for binary traces
+    size_t               map_size;
+    trace_record_t       *decoded;    // private array for text traces
+} trace_t;
+
+/*
+ * A trace being read and decoded on a thread of its own, from a file or a
+ * pipe, for the simulation to take in batches.
+ */
+typedef struct trace_reader trace_reader_t;
+
+/*
+ * Geometry, replacement policy and timing of one cache.  latency is the
+ * total number of cycles until a block served by this level can be used.
+ */
+typedef struct iplc_cache_config
+{
+    int          index;                // index bits, 2^index sets
+    int          blocksize;            // words per block
+    int          assoc;
+    int          policy;               // enum replacement_policy
+    int          latency;
+    int          inclusion;            // enum inclusion_policy, L2 and L3 only
+} iplc_cache_config_t;
+
+/*
+ * One L1 prefetcher.
+ */
+typedef struct iplc_prefetch_config
+{
+    int          type;                 // enum prefetcher_type
+    int          degree;               // blocks fetched ahead, 1 to MAX_PREFETCH_DEGREE
+    int          entries;              // stride table entries or streams, a power of two
+} iplc_prefetch_config_t;
+
+/*
+ * A SimPoint: the interval-th window of the trace (counting from 0, in
+ * sample_window instructions) and the weight of the phase it stands for.
+ */
+typedef struct iplc_simpoint
+{
+    long         interval;
+    double       weight;
+} iplc_simpoint_t;
+
+/*
+ * Simulator configuration.  Fill in with iplc_sim_config_init() and then
+ * override what you need.
+ */
+typedef struct iplc_sim_config
+{
+    iplc_cache_config_t icache;        // instruction fetches
+    iplc_cache_config_t dcache;        // lw / sw data accesses
+    iplc_cache_config_t l2;            // unified, shared by both L1s
+    iplc_cache_config_t l3;
+    int          levels;               // 1 (L1 only) to MAX_CACHE_LEVELS
+    int          memory_latency;
+    unsigned int seed;                 // for the random and BRRIP policies
+    unsigned int branch_predict_taken;
+    int          predictor;            // enum branch_predictor_type
+    int          bp_table_bits;        // 2^bits counters per table
+    int          bp_history_bits;      // gshare global history length
+    int          bp_chooser_bits;      // 2^bits tournament chooser counters
+    int          btb_entries;          // direct mapped, power of two, 0 for none
+    int          ras_depth;            // return address stack, 0 for none
+    int          hazards;              // enum hazard_model
+    int          pipeline_depth;       // 5 (IF ID EX MEM WB) to MAX_PIPELINE_DEPTH
+    int          issue_width;          // instructions per cycle, 1 to MAX_ISSUE_WIDTH
+    int          rob_entries;          // out-of-order core next to the pipeline, 0 for none
+    int          iq_entries;           // its issue queue, 0 for half the ROB
+    int          lsq_entries;          // its load/store queue, 0 for half the ROB
+    int          mshrs;                // D-cache misses in flight, 0 for a blocking D-cache
+    int          write_policy;         // enum write_policy, for the D-cache
+    int          write_allocate;       // a sw miss brings the block in
+    int          write_buffer;         // coalescing entries below the D-cache, 0 for none
+    iplc_prefetch_config_t icache_prefetch;
+    iplc_prefetch_config_t dcache_prefetch;
+    unsigned int classify_misses;      // split misses into compulsory, capacity and conflict
+    unsigned int profile;              // charge misses, stalls and mispredicts to their PCs
+    int          interval;             // interval statistics every so many units, 0 for none
+    int          interval_unit;        // enum interval_unit
+    int          bbv_dims;             // basic block vector per interval, a power of two or 0
+    FILE         *interval_out;        // where the intervals are written, if anywhere
+    unsigned int interval_binary;      // as interval_record_t rather than CSV
+    long         sample_window;        // instructions measured per sample, 0 simulates everything
+    long         sample_warmup;        // detailed instructions run before each window
+    long         sample_period;        // one window every so many instructions, or 0 with simpoints
+    const iplc_simpoint_t *simpoints;  // windows to measure instead of a period
+    int          num_simpoints;
+    unsigned int events;               // enum event_category mask
+    FILE         *out;                 // where text events go, stdout if NULL
+    FILE         *event_out;           // binary events go here instead, if set
+    unsigned int scalar_tag_match;     // skip the SIMD tag compare (for benchmarking)
+} iplc_sim_config_t;
+
+/*
+ * With classify_misses the misses are also split into compulsory (first
+ * touch of the block), capacity (a fully associative LRU cache of the same
+ * size misses too) and conflict (the rest).
+ */
+typedef struct iplc_cache_stats
+{
+    long         access;
+    long         miss;
+    long         hit;
+    long         compulsory;
+    long         capacity;
+    long         conflict;
+} iplc_cache_stats_t;
+
+/*
+ * Branch prediction results.  Each misprediction costs the pipeline a
+ * bubble; the *_cycles fields are those bubbles by what caused them.
+ */
+typedef struct iplc_branch_stats
+{
+    int          predictor;
+    long         predictions;          // beq directions
+    long         correct;              // fetch went down the right path
+    long         bimodal_correct;      // tournament components as if used alone
+    long         gshare_correct;
+    long         chooser_gshare;       // times the chooser went with gshare
+    long         btb_lookups;          // predicted taken branches
+    long         btb_hits;
+    long         ras_predictions;      // jr
+    long         ras_correct;
+    long         direction_mispredicts;
+    long         btb_mispredicts;
+    long         ras_mispredicts;
+    long         direction_cycles;
+    long         btb_cycles;
+    long         ras_cycles;
+} iplc_branch_stats_t;
+
+/*
+ * Data hazard stall cycles by cause, and how many operands were forwarded
+ * instead of stalling.
+ */
+typedef struct iplc_hazard_stats
+{
+    int          model;
+    long         load_use_cycles;      // consumer right behind a lw
+    long         data_cycles;          // any other RAW stall, without forwarding
+    long         branch_cycles;        // beq / jr operands needed in decode
+    long         exmem_forwards;
+    long         memwb_forwards;
+} iplc_hazard_stats_t;
+
+/*
+ * Non-blocking D-cache results.  miss_cycles is the latency of every
+ * primary miss beyond the one cycle MEM takes, what a blocking D-cache
+ * would stall for; the pipeline only lost wait_cycles and full_cycles of
+ * it.  busy_cycles sums the MSHRs in use over every cycle and
+ * active_cycles counts the cycles with at least one in use.
+ */
+typedef struct iplc_mshr_stats
+{
+    int          mshrs;
+    long         primary_misses;
+    long         secondary_misses;     // merged into an MSHR already in flight
+    long         miss_cycles;
+    long         wait_cycles;          // instructions waiting on data in flight
+    long         full_cycles;          // misses waiting for a free MSHR
+    long         busy_cycles;
+    long         active_cycles;
+} iplc_mshr_stats_t;
+
+/*
+ * D-cache write traffic.  writes counts the stores and writebacks sent
+ * below the D-cache and bytes what they moved: a word per store, a block
+ * per writeback.  The *_cycles are what the pipeline stalled for beyond
+ * MEM; buffer_full_cycles is the part of them spent waiting for a write
+ * buffer entry.
+ */
+typedef struct iplc_write_stats
+{
+    int          policy;               // enum write_policy
+    int          allocate;
+    int          buffer_entries;
+    long         stores;
+    long         store_misses;
+    long         writebacks;           // dirty blocks evicted
+    long         writes;
+    long         coalesced;            // writes merged into a write buffer entry
+    long         bytes;
+    long         store_cycles;
+    long         writeback_cycles;
+    long         buffer_full_cycles;
+} iplc_write_stats_t;
+
+/*
+ * One L1 prefetcher's results.  useful counts prefetched blocks a demand
+ * access went on to use, late the ones of those it found still on their
+ * way; unused were evicted untouched; dropped were turned away with the
+ * prefetch queue full; pollution counts demand misses on blocks a prefetch
+ * had evicted.
+ */
+typedef struct iplc_prefetch_stats
+{
+    int          type;                 // enum prefetcher_type
+    int          degree;
+    int          entries;
+    long         issued;
+    long         useful;
+    long         late;
+    long         unused;
+    long         dropped;
+    long         pollution;
+} iplc_prefetch_stats_t;
+
+/*
+ * The out-of-order core, timed on the same fetches and cache latencies as
+ * the in-order pipeline.  rob_occupancy is the ROB entries in use summed
+ * over every cycle; the *_full_cycles are cycles dispatch spent waiting on
+ * a full structure.
+ */
+typedef struct iplc_ooo_stats
+{
+    int          rob_entries;
+    int          iq_entries;
+    int          lsq_entries;
+    long         cycles;
+    long         instructions;
+    long         rob_occupancy;
+    long         rob_full_cycles;
+    long         iq_full_cycles;
+    long         lsq_full_cycles;
+    long         fetch_stall_cycles;   // I-cache misses and mispredict redirects
+} iplc_ooo_stats_t;
+
+/*
+ * One instruction address in the hotspot profile.  Misses and mispredicts
+ * go to the instruction that had them; the *_cycles are stall cycles
+ * charged to the instruction holding the pipeline up: a fetch or memory
+ * access for its own latency, an instruction waiting on an operand (on a
+ * lw miss in flight that counts as D-cache) and a mispredicted branch or
+ * jump for the refetch.  stall_cycles is their sum.
+ */
+typedef struct iplc_profile_entry
+{
+    unsigned int pc;
+    long         instructions;
+    long         icache_misses;
+    long         dcache_misses;
+    long         mispredicts;
+    long         icache_cycles;
+    long         dcache_cycles;
+    long         hazard_cycles;
+    long         branch_cycles;
+    long         stall_cycles;
+} iplc_profile_entry_t;
+
+/*
+ * Interval statistics.  With a BBV each interval is matched to the phase
+ * whose first interval had the nearest signature, or starts a new phase.
+ */
+typedef struct iplc_interval_stats
+{
+    int          length;               // 0 without intervals
+    int          unit;                 // enum interval_unit
+    int          bbv_dims;
+    long         intervals;
+    int          phases;
+    double       min_cpi;
+    double       max_cpi;
+} iplc_interval_stats_t;
+
+/*
+ * Sampled simulation.  cpi is the weighted mean over the windows and
+ * cpi_bound the half width of its 95% confidence interval, taking the
+ * windows as independent samples; estimated_cycles is cpi over every
+ * instruction of the trace.
+ */
+typedef struct iplc_sample_stats
+{
+    long         window;               // 0 when not sampling
+    long         warmup;
+    long         period;
+    int          simpoints;
+    long         windows;
+    long         instructions;         // every instruction of the trace
+    long         detailed_instructions;
+    double       cpi;
+    double       cpi_bound;
+    double       estimated_cycles;
+} iplc_sample_stats_t;
+
+/*
+ * cache_access, cache_miss and cache_hit are the totals over both L1 caches.
+ * When sampling they count the fast-forwarded accesses too, while the
+ * pipeline counters only cover the detailed parts.
+ */
+typedef struct iplc_sim_stats
+{
+    long         cache_access;
+    long         cache_miss;
+    long         cache_hit;
+    iplc_cache_stats_t icache;
+    iplc_cache_stats_t dcache;
+    iplc_cache_stats_t l2;
+    iplc_cache_stats_t l3;
+    long         memory_access;
+    int          levels;
+    unsigned int classified;           // the 3C split is there
+    int          pipeline_depth;
+    int          issue_width;
+    long         pipeline_cycles;
+    long         instruction_count;
+    long         branch_count;
+    long         correct_branch_predictions;
+    iplc_branch_stats_t branch;
+    iplc_hazard_stats_t hazard;
+    iplc_ooo_stats_t ooo;                // rob_entries is 0 without one
+    iplc_mshr_stats_t mshr;              // mshrs is 0 for a blocking D-cache
+    iplc_write_stats_t write;
+    iplc_prefetch_stats_t icache_prefetch; // type is PREFETCH_NONE without one
+    iplc_prefetch_stats_t dcache_prefetch;
+    iplc_interval_stats_t interval;
+    iplc_sample_stats_t sample;
+    int          partitions;           // cache-only workers, 0 for a full simulation
+} iplc_sim_stats_t;
+
+/*
+ * One simulator instance.  Instances share nothing, so any number of them
+ * can run at once on separate threads.
+ */
+typedef struct iplc_sim iplc_sim_t;
+
+// Simulator functions
+void iplc_sim_config_init(iplc_sim_config_t *config);
+unsigned long iplc_sim_cache_size(int index, int blocksize, int assoc);
+int iplc_sim_policy_by_name(const char *name);
+int iplc_sim_inclusion_by_name(const char *name);
+int iplc_sim_predictor_by_name(const char *name);
+int iplc_sim_hazards_by_name(const char *name);
+int iplc_sim_write_policy_by_name(const char *name);
+int iplc_sim_prefetcher_by_name(const char *name);
+const char *iplc_sim_config_error(const iplc_sim_config_t *config);
+iplc_sim_t *iplc_sim_create(const iplc_sim_config_t *config);
+int iplc_sim_step(iplc_sim_t *sim, const trace_record_t *rec);
+void iplc_sim_finalize(iplc_sim_t *sim, iplc_sim_stats_t *stats);
+void iplc_sim_destroy(iplc_sim_t *sim);
+int iplc_sim_profile(iplc_sim_t *sim, const iplc_profile_entry_t **entries);
+void iplc_sim_print_profile(FILE *out, const iplc_profile_entry_t *entries, int count, int top,
+                            long cycles);
+void iplc_sim_print_stats(FILE *out, const iplc_sim_stats_t *stats);
+
+// Options and structured results
+int iplc_sim_parse_cache_option(const char *arg, iplc_cache_config_t *cache);
+int iplc_sim_parse_predictor_option(const char *arg, iplc_sim_config_t *config);
+int iplc_sim_parse_pipeline_option(const char *arg, iplc_sim_config_t *config);
+int iplc_sim_parse_ooo_option(const char *arg, iplc_sim_config_t *config);
+int iplc_sim_parse_write_option(const char *arg, iplc_sim_config_t *config);
+int iplc_sim_parse_prefetch_option(const char *arg, iplc_sim_config_t *config);
+int iplc_sim_parse_interval_option(const char *arg, iplc_sim_config_t *config);
+int iplc_sim_parse_sample_option(const char *arg, iplc_sim_config_t *config);
+int iplc_sim_load_simpoints(const char *file_name, const char *weights_file_name, iplc_simpoint_t **simpoints);
+int iplc_sim_parse_options(iplc_sim_config_t *config, const char *line);
+int iplc_sim_output_by_name(const char *name);
+void iplc_sim_print_csv_header(FILE *out);
+void iplc_sim_print_csv(FILE *out, const iplc_sim_config_t *config, const iplc_sim_stats_t *stats);
+void iplc_sim_print_json(FILE *out, const iplc_sim_config_t *config, const iplc_sim_stats_t *stats);
+void iplc_sim_print_results(FILE *out, int format, const iplc_sim_config_t *configs,
+                            const iplc_sim_stats_t *stats, int count);
+void iplc_sim_export_profile(FILE *out, const iplc_profile_entry_t *entries, int count, int folded);
+
+// Cache-only simulation
+int iplc_sim_cache_only(const trace_t *trace, const iplc_sim_config_t *config, int num_threads,
+                        iplc_sim_stats_t *stats);
+
+// Checkpoints
+int iplc_sim_checkpoint(iplc_sim_t *sim, const char *file_name, uint64_t records, uint64_t offset);
+iplc_sim_t *iplc_sim_restore(const char *file_name, const iplc_sim_config_t *config,
+                             uint64_t *records, uint64_t *offset);
+
+// Event functions
+unsigned int iplc_sim_event_level(int level);
+int iplc_sim_events_by_name(const char *names);
+int iplc_sim_decode_events(FILE *in, FILE *out);
+
+// Trace functions
+int iplc_sim_decode_instruction(const char *buffer, trace_record_t *rec);
+int iplc_sim_map_trace(const char *file_name, trace_t *trace);
+int iplc_sim_load_trace(const char *file_name, trace_t *trace);
+void iplc_sim_free_trace(trace_t *trace);
+FILE *iplc_sim_open_trace(const char *file_name);
+int iplc_sim_convert_trace(FILE *trace_file, const char *out_file_name);
+trace_reader_t *iplc_sim_open_reader(FILE *in, uint64_t records, uint64_t offset);
+long iplc_sim_read_batch(trace_reader_t *reader, const trace_record_t **records, const uint64_t **ends);
+void iplc_sim_close_reader(trace_reader_t *reader);
+
+// Stack distance analysis
+int iplc_sim_stack_analysis(const trace_t *trace, FILE *out);
+
+// Parameter sweeps
+int iplc_sim_sweep(const trace_t *trace, const char *sweep_file_name, const iplc_sim_config_t *base,
+                   int num_threads, int format, FILE *out);
+
+#endif
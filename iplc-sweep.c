@@ -0,0 +1,310 @@
+/***********************************************************************/
+/***********************************************************************
+ Pipeline Cache Simulator -- multi-threaded parameter sweeps
+ ***********************************************************************/
+/***********************************************************************/
+#include <pthread.h>
+
+#include "iplc-internal.h"
+
+/************************************************************************************************/
+/* Sweep Functions ******************************************************************************/
+/************************************************************************************************/
+
+/*
+ * Per worker queue of config indices.  The owner pops from the tail, idle
+ * workers steal from the head.  Tasks are whole simulations, so a mutex per
+ * queue costs nothing measurable.
+ */
+typedef struct sweep_queue
+{
+    pthread_mutex_t lock;
+    int             *tasks;
+    int             head;
+    int             tail;
+} sweep_queue_t;
+
+typedef struct sweep
+{
+    const trace_t        *trace;
+    iplc_sim_config_t    *configs;        // one per line of the sweep file
+    iplc_sim_stats_t     *stats;          // and its results once it has run
+    long                 *failed;         // or the bad record + 1 it stopped at, -1 out of memory
+    sweep_queue_t        *queues;
+    int                  num_threads;
+} sweep_t;
+
+typedef struct sweep_worker
+{
+    sweep_t   *sweep;
+    int       id;
+    int       started;
+    pthread_t thread;
+} sweep_worker_t;
+
+static int sweep_take(sweep_t *sweep, int id)
+{
+    sweep_queue_t *queue;
+    int task = -1;
+    int i;
+    
+    queue = &sweep->queues[id];
+    pthread_mutex_lock(&queue->lock);
+    if (queue->tail > queue->head)
+        task = queue->tasks[--queue->tail];
+    pthread_mutex_unlock(&queue->lock);
+    
+    // own queue is empty, steal the oldest task from someone else
+    for (i = 1; task < 0 && i < sweep->num_threads; i++) {
+        queue = &sweep->queues[(id + i) % sweep->num_threads];
+        pthread_mutex_lock(&queue->lock);
+        if (queue->tail > queue->head)
+            task = queue->tasks[queue->head++];
+        pthread_mutex_unlock(&queue->lock);
+    }
+    
+    return task;
+}
+
+static void sweep_run(sweep_t *sweep, int task)
+{
+    iplc_sim_t *sim = NULL;
+    unsigned long r;
+    
+    // configs were checked against MAX_CACHE_SIZE when the file was read
+    sim = iplc_sim_create(&sweep->configs[task]);
+    if (sim == NULL) {
+        sweep->failed[task] = -1;
+        return;
+    }
+    
+    for (r = 0; r < sweep->trace->count; r++) {
+        if (iplc_sim_step(sim, &sweep->trace->records[r]) < 0) {
+            sweep->failed[task] = (long) r + 1;
+            break;
+        }
+    }
+    if (!sweep->failed[task])
+        iplc_sim_finalize(sim, &sweep->stats[task]);
+    
+    iplc_sim_destroy(sim);
+}
+
+static void *sweep_worker(void *arg)
+{
+    sweep_worker_t *worker = (sweep_worker_t *) arg;
+    int task;
+    
+    while ((task = sweep_take(worker->sweep, worker->id)) >= 0)
+        sweep_run(worker->sweep, task);
+    
+    return NULL;
+}
+
+/*
+ * Read "index blocksize assoc [branch_predict_taken [policy [dindex dblocksize
+ * dassoc [dpolicy]]]]" lines, '#' starts a comment.  The first geometry is the
+ * I-cache; the D-cache is the same unless given.  Everything else (L2, L3,
+ * latencies) comes from base.  A line starting with '-' is instead a job of
+ * command line options, see iplc_sim_parse_options().  Returns -1 on a malformed line or a
+ * configuration iplc_sim_config_error() rejects, so a long sweep does not
+ * die halfway through.
+ */
+static int sweep_read_configs(const char *sweep_file_name, const iplc_sim_config_t *base,
+                              iplc_sim_config_t **configs_out, int *num_configs)
+{
+    const char *error;
+    FILE *sweep_file = NULL;
+    iplc_sim_config_t *configs = NULL, *grown = NULL;
+    iplc_sim_config_t config;
+    char buffer[256];
+    char policy[32], dpolicy[32];
+    int capacity = 0, line = 0, fields;
+    
+    sweep_file = fopen(sweep_file_name, "r");
+    if (sweep_file == NULL) {
+        printf("fopen failed for %s file\n", sweep_file_name);
+        return -1;
+    }
+    
+    *num_configs = 0;
+    while (fgets(buffer, sizeof(buffer), sweep_file) != NULL) {
+        line++;
+        if (strchr(buffer, '#'))
+            *strchr(buffer, '#') = '\0';
+        
+        config = *base;
+        config.out = NULL;
+        config.event_out = NULL;
+        config.events = 0;
+        if (buffer[strspn(buffer, " \t")] == '-') {
+            if (iplc_sim_parse_options(&config, buffer) < 0) {
+                printf("Malformed sweep config at %s:%d \n", sweep_file_name, line);
+                break;
+            }
+        }
+        else {
+            config.branch_predict_taken = 0;
+            fields = sscanf(buffer, "%d %d %d %u %31s %d %d %d %31s",
+                            &config.icache.index, &config.icache.blocksize, &config.icache.assoc,
+                            &config.branch_predict_taken, policy, &config.dcache.index,
+                            &config.dcache.blocksize, &config.dcache.assoc, dpolicy);
+            if (fields <= 0)
+                continue;
+            if (fields >= 5) {
+                config.icache.policy = iplc_sim_policy_by_name(policy);
+                config.dcache.policy = config.icache.policy;
+            }
+            if (fields < 8) {
+                config.dcache.index = config.icache.index;
+                config.dcache.blocksize = config.icache.blocksize;
+                config.dcache.assoc = config.icache.assoc;
+            }
+            if (fields == 9)
+                config.dcache.policy = iplc_sim_policy_by_name(dpolicy);
+            if (fields < 3 || (fields > 5 && fields < 8)) {
+                printf("Malformed sweep config at %s:%d \n", sweep_file_name, line);
+                break;
+            }
+        }
+        error = iplc_sim_config_error(&config);
+        if (error) {
+            printf("%s at %s:%d \n", error, sweep_file_name, line);
+            break;
+        }
+        
+        if (*num_configs == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            grown = (iplc_sim_config_t *) realloc(configs, capacity * sizeof(iplc_sim_config_t));
+            if (grown == NULL) {
+                printf("Out of memory reading %s \n", sweep_file_name);
+                break;
+            }
+            configs = grown;
+        }
+        configs[(*num_configs)++] = config;
+    }
+    
+    if (!feof(sweep_file)) {
+        fclose(sweep_file);
+        free(configs);
+        return -1;
+    }
+    
+    fclose(sweep_file);
+    *configs_out = configs;
+    return 0;
+}
+
+/*
+ * Say why configurations failed: the first one, and how many more.
+ * Returns how many failed.
+ */
+static int sweep_report_failures(const sweep_t *sweep, int num_configs)
+{
+    const trace_record_t *rec;
+    int i, count = 0;
+    
+    for (i = 0; i < num_configs; i++) {
+        if (!sweep->failed[i])
+            continue;
+        if (count++)
+            continue;
+        if (sweep->failed[i] < 0)
+            printf("Out of memory creating the simulator for sweep config %d \n", i + 1);
+        else {
+            rec = &sweep->trace->records[sweep->failed[i] - 1];
+            printf("Bad opcode %d at address %x in sweep config %d \n",
+                   rec->opcode, rec->instruction_address, i + 1);
+        }
+    }
+    if (count > 1)
+        printf("%d more sweep configs failed \n", count - 1);
+    return count;
+}
+
+/*
+ * Run every configuration in the sweep file, each on top of base, against
+ * the same in-memory trace on num_threads workers, then print the results
+ * in file order with iplc_sim_print_results().  Returns -1 if the sweep
+ * file is bad or any configuration could not be run, and then prints no
+ * results.
+ */
+int iplc_sim_sweep(const trace_t *trace, const char *sweep_file_name, const iplc_sim_config_t *base,
+                   int num_threads, int format, FILE *out)
+{
+    sweep_t sweep;
+    sweep_worker_t *workers = NULL;
+    iplc_sim_config_t *configs = NULL;
+    int num_configs = 0;
+    int i, t, error = 0;
+    
+    if (sweep_read_configs(sweep_file_name, base, &configs, &num_configs) < 0)
+        return -1;
+    
+    if (num_threads > num_configs)
+        num_threads = num_configs;
+    if (num_threads < 1)
+        num_threads = 1;
+    
+    sweep.trace = trace;
+    sweep.configs = configs;
+    sweep.stats = (iplc_sim_stats_t *) calloc(num_configs ? num_configs : 1, sizeof(iplc_sim_stats_t));
+    sweep.failed = (long *) calloc(num_configs ? num_configs : 1, sizeof(long));
+    sweep.num_threads = num_threads;
+    sweep.queues = (sweep_queue_t *) calloc(num_threads, sizeof(sweep_queue_t));
+    workers = (sweep_worker_t *) calloc(num_threads, sizeof(sweep_worker_t));
+    if (sweep.stats == NULL || sweep.failed == NULL || sweep.queues == NULL || workers == NULL) {
+        free(sweep.stats);
+        free(sweep.failed);
+        free(sweep.queues);
+        free(workers);
+        free(configs);
+        return -1;
+    }
+    
+    for (t = 0; t < num_threads; t++) {
+        pthread_mutex_init(&sweep.queues[t].lock, NULL);
+        sweep.queues[t].tasks = (int *) malloc((num_configs / num_threads + 1) * sizeof(int));
+        if (sweep.queues[t].tasks == NULL)
+            error = 1;
+    }
+    
+    if (!error) {
+        // deal contiguous runs of configs to each worker up front
+        for (i = 0; i < num_configs; i++) {
+            t = (int) ((long) i * num_threads / num_configs);
+            sweep.queues[t].tasks[sweep.queues[t].tail++] = i;
+        }
+        
+        for (t = 0; t < num_threads; t++) {
+            workers[t].sweep = &sweep;
+            workers[t].id = t;
+            workers[t].started = (pthread_create(&workers[t].thread, NULL, sweep_worker, &workers[t]) == 0);
+        }
+        
+        // a worker that could not be started is run here; the others steal from it anyway
+        for (t = 0; t < num_threads; t++)
+            if (!workers[t].started)
+                sweep_worker(&workers[t]);
+        for (t = 0; t < num_threads; t++)
+            if (workers[t].started)
+                pthread_join(workers[t].thread, NULL);
+        
+        if (sweep_report_failures(&sweep, num_configs))
+            error = 1;
+        else
+            iplc_sim_print_results(out, format, configs, sweep.stats, num_configs);
+    }
+    
+    for (t = 0; t < num_threads; t++) {
+        pthread_mutex_destroy(&sweep.queues[t].lock);
+        free(sweep.queues[t].tasks);
+    }
+    free(sweep.queues);
+    free(workers);
+    free(sweep.stats);
+    free(sweep.failed);
+    free(configs);
+    return error ? -1 : 0;
+}
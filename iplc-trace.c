@@ -0,0 +1,449 @@
+/***********************************************************************/
+/***********************************************************************
+ Pipeline Cache Simulator -- trace decoding and binary traces
+ ***********************************************************************/
+/***********************************************************************/
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "iplc-internal.h"
+
+const char *opcode_names[NUM_OPCODES] = {
+    "nop", "add", "addi", "addiu", "addu", "sll", "ori", "lui",
+    "lw", "sw", "beq", "j", "jal", "jr", "syscall"
+};
+
+/************************************************************************************************/
+/* parse Function *******************************************************************************/
+/************************************************************************************************/
+
+/*
+ * Turn a register ("$4,") or constant ("-4") operand into a number.
+ */
+static unsigned int iplc_sim_parse_reg(char *reg_str)
+{
+    int i;
+    // turn comma into \n
+    if (reg_str[strlen(reg_str)-1] == ',')
+        reg_str[strlen(reg_str)-1] = '\n';
+    
+    if (reg_str[0] != '$')
+        return atoi(reg_str);
+    else {
+        // copy down over $ character than return atoi
+        for (i = 0; i < strlen(reg_str); i++)
+            reg_str[i] = reg_str[i+1];
+        
+        return atoi(reg_str);
+    }
+}
+
+/*
+ * Decode one line of the text trace into a trace record.  This is the only
+ * place that looks at the instruction text; everything downstream works on
+ * the decoded record.  Returns -1 on a malformed line.
+ */
+int iplc_sim_decode_instruction(const char *buffer, trace_record_t *rec)
+{
+    int i=0;
+    int offset=0, base_reg=-1;
+    unsigned int instruction_address=0;
+    unsigned int data_address=0;
+    char instruction[16];
+    char reg1[16];
+    char offsetwithreg[16];
+    char str_src_reg[16];
+    char str_src_reg2[16];
+    char str_dest_reg[16];
+    char str_constant[16];
+    
+    bzero(rec, sizeof(trace_record_t));
+    rec->dest_reg = -1;
+    rec->src_reg1 = -1;
+    rec->src_reg2 = -1;
+    
+    if (sscanf(buffer, "%x %15s", &instruction_address, instruction ) != 2) {
+        printf("Malformed instruction \n");
+        return -1;
+    }
+    rec->instruction_address = instruction_address;
+    
+    rec->opcode = NUM_OPCODES;
+    for (i = 0; i < NUM_OPCODES; i++) {
+        if (strcmp(instruction, opcode_names[i]) == 0) {
+            rec->opcode = i;
+            break;
+        }
+    }
+    
+    if (strncmp( instruction, "add", 3 ) == 0 ||
+        strncmp( instruction, "sll", 3 ) == 0 ||
+        strncmp( instruction, "ori", 3 ) == 0) {
+        if (sscanf(buffer, "%x %15s %15s %15s %15s",
+                   &instruction_address,
+                   instruction,
+                   str_dest_reg,
+                   str_src_reg,
+                   str_src_reg2 ) != 5) {
+            printf("Malformed RTYPE instruction (%s) at address 0x%x \n",
+                   instruction, instruction_address);
+            return -1;
+        }
+        
+        // unknown variants keep the timing of their family
+        if (rec->opcode == NUM_OPCODES)
+            rec->opcode = (instruction[0] == 'a') ? OP_ADD : (instruction[0] == 's') ? OP_SLL : OP_ORI;
+        
+        rec->dest_reg = iplc_sim_parse_reg(str_dest_reg);
+        rec->src_reg1 = iplc_sim_parse_reg(str_src_reg);
+        if (str_src_reg2[0] == '$')
+            rec->src_reg2 = iplc_sim_parse_reg(str_src_reg2);
+        else
+            rec->constant = iplc_sim_parse_reg(str_src_reg2);
+    }
+    
+    else if (strncmp( instruction, "lui", 3 ) == 0) {
+        if (sscanf(buffer, "%x %15s %15s %15s",
+                   &instruction_address,
+                   instruction,
+                   str_dest_reg,
+                   str_constant ) != 4 ) {
+            printf("Malformed RTYPE instruction (%s) at address 0x%x \n",
+                   instruction, instruction_address );
+            return -1;
+        }
+        
+        rec->opcode = OP_LUI;
+        rec->dest_reg = iplc_sim_parse_reg(str_dest_reg);
+        rec->constant = iplc_sim_parse_reg(str_constant);
+    }
+    
+    else if (strncmp( instruction, "lw", 2 ) == 0 ||
+             strncmp( instruction, "sw", 2 ) == 0  ) {
+        if ( sscanf( buffer, "%x %15s %15s %15s %x",
+                    &instruction_address,
+                    instruction,
+                    reg1,
+                    offsetwithreg,
+                    &data_address ) != 5) {
+            printf("Bad instruction: %s at address %x \n", instruction, instruction_address);
+            return -1;
+        }
+        
+        // offsetwithreg looks like "0($29):"
+        if (sscanf(offsetwithreg, "%d($%d", &offset, &base_reg) != 2)
+            base_reg = -1;
+        rec->constant = offset;
+        rec->data_address = data_address;
+        
+        if (strncmp(instruction, "lw", 2) == 0) {
+            rec->opcode = OP_LW;
+            rec->dest_reg = iplc_sim_parse_reg(reg1);
+            rec->src_reg1 = base_reg;
+        }
+        else {
+            rec->opcode = OP_SW;
+            rec->src_reg1 = iplc_sim_parse_reg(reg1);
+            rec->src_reg2 = base_reg;
+        }
+    }
+    else if (strncmp( instruction, "beq", 3 ) == 0) {
+        rec->opcode = OP_BEQ;
+        if (sscanf(buffer, "%x %15s %15s %15s %15s",
+                   &instruction_address,
+                   instruction,
+                   str_src_reg,
+                   str_src_reg2,
+                   str_constant ) == 5) {
+            rec->src_reg1 = iplc_sim_parse_reg(str_src_reg);
+            rec->src_reg2 = iplc_sim_parse_reg(str_src_reg2);
+            rec->constant = atoi(str_constant);
+        }
+    }
+    else if (strncmp( instruction, "jal", 3 ) == 0 ||
+             strncmp( instruction, "jr", 2 ) == 0 ||
+             strncmp( instruction, "j", 1 ) == 0 ) {
+        /*
+         * Note: no need to worry about forwarding on the jump register
+         * we'll let that one go.
+         */
+        if (strncmp( instruction, "jr", 2 ) == 0) {
+            rec->opcode = OP_JR;
+            if (sscanf(buffer, "%x %15s %15s", &instruction_address, instruction, str_src_reg) == 3)
+                rec->src_reg1 = iplc_sim_parse_reg(str_src_reg);
+        }
+        else {
+            rec->opcode = (strncmp( instruction, "jal", 3 ) == 0) ? OP_JAL : OP_J;
+            if (sscanf(buffer, "%x %15s %x", &instruction_address, instruction, &data_address) == 3)
+                rec->constant = data_address;
+        }
+    }
+    else if ( strncmp( instruction, "syscall", 7 ) == 0) {
+        rec->opcode = OP_SYSCALL;
+    }
+    else if ( strncmp( instruction, "nop", 3 ) == 0) {
+        rec->opcode = OP_NOP;
+    }
+    else {
+        printf("Do not know how to process instruction: %s at address %x \n",
+               instruction, instruction_address );
+        return -1;
+    }
+    
+    return 0;
+}
+
+/************************************************************************************************/
+/* Trace Functions ******************************************************************************/
+/************************************************************************************************/
+
+/*
+ * Memory-map a binary trace.  Returns 1 if the file was mapped, 0 if it is
+ * not a binary trace (so the caller can fall back to the text parser) and
+ * -1 for a file that has the binary magic but a bad header.
+ */
+int iplc_sim_map_trace(const char *file_name, trace_t *trace)
+{
+    int fd;
+    struct stat st;
+    const trace_header_t *header = NULL;
+    void *map = NULL;
+    
+    bzero(trace, sizeof(trace_t));
+    
+    fd = open(file_name, O_RDONLY);
+    if (fd < 0)
+        return 0;
+    
+    if (fstat(fd, &st) < 0 || st.st_size < sizeof(trace_header_t)) {
+        close(fd);
+        return 0;
+    }
+    
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return 0;
+    
+    header = (const trace_header_t *) map;
+    if (memcmp(header->magic, TRACE_MAGIC, sizeof(header->magic)) != 0) {
+        munmap(map, st.st_size);
+        return 0;
+    }
+    
+    if (header->version != TRACE_VERSION ||
+        header->record_size != sizeof(trace_record_t) ||
+        header->record_count > (st.st_size - sizeof(trace_header_t)) / sizeof(trace_record_t)) {
+        printf("Bad binary trace header in %s \n", file_name);
+        munmap(map, st.st_size);
+        return -1;
+    }
+    
+    madvise(map, st.st_size, MADV_SEQUENTIAL);
+    
+    trace->map = map;
+    trace->map_size = st.st_size;
+    trace->records = (const trace_record_t *) (header + 1);
+    trace->count = header->record_count;
+    return 1;
+}
+
+/*
+ * Append value to out as a LEB128 varint, zigzagged first so small
+ * negative numbers stay short.  Returns the bytes written, at most 5.
+ */
+static int iplc_sim_put_varint(unsigned char *out, int32_t value)
+{
+    uint32_t zigzag = ((uint32_t) value << 1) ^ (uint32_t) (value >> 31);
+    int n = 0;
+    
+    while (zigzag >= 0x80) {
+        out[n++] = (unsigned char) (zigzag | 0x80);
+        zigzag >>= 7;
+    }
+    out[n++] = (unsigned char) zigzag;
+    return n;
+}
+
+/*
+ * Encode rec in the delta trace format against last, the record before
+ * it, which becomes rec.  Returns the length, or -1 for a record the
+ * format cannot hold.
+ */
+static int iplc_sim_delta_encode(const trace_record_t *rec, trace_record_t *last, unsigned char *out)
+{
+    uint32_t next = last->instruction_address + 4;
+    unsigned int regs;
+    int n = 1;
+    
+    if (rec->opcode >= NUM_OPCODES || rec->dest_reg < -1 || rec->dest_reg > 31 ||
+        rec->src_reg1 < -1 || rec->src_reg1 > 31 || rec->src_reg2 < -1 || rec->src_reg2 > 31)
+        return -1;
+    
+    out[0] = rec->opcode;
+    if (rec->instruction_address == next)
+        out[0] |= DELTA_SEQUENTIAL;
+    else
+        n += iplc_sim_put_varint(out + n, (int32_t) (rec->instruction_address - next));
+    
+    regs = ((rec->dest_reg + 1) * 33 + rec->src_reg1 + 1) * 33 + rec->src_reg2 + 1;
+    out[n++] = (unsigned char) regs;
+    out[n++] = (unsigned char) (regs >> 8);
+    
+    // a data address or constant of 0 is left out
+    if (rec->data_address) {
+        out[0] |= DELTA_DATA;
+        n += iplc_sim_put_varint(out + n, (int32_t) (rec->data_address - last->data_address));
+        last->data_address = rec->data_address;
+    }
+    if (rec->constant) {
+        out[0] |= DELTA_CONSTANT;
+        n += iplc_sim_put_varint(out + n, rec->constant);
+    }
+    last->instruction_address = rec->instruction_address;
+    return n;
+}
+
+/*
+ * Convert any trace the simulator reads, text, binary or delta, plain or
+ * compressed, into the binary trace format, or the delta format when
+ * out_file_name ends in .itd.  The file is written beside out_file_name
+ * and renamed over it once complete, so nothing is left behind when it
+ * fails.  Returns -1 on a malformed trace or a write error.
+ */
+int iplc_sim_convert_trace(FILE *trace_file, const char *out_file_name)
+{
+    FILE *out_file = NULL;
+    trace_reader_t *reader = NULL;
+    trace_header_t header;
+    trace_record_t last;
+    const trace_record_t *batch;
+    unsigned char packed[32];
+    char temp_name[1024];
+    size_t name_length = strlen(out_file_name);
+    int delta = name_length > 4 && strcmp(out_file_name + name_length - 4, ".itd") == 0;
+    long count, r;
+    int length, failed;
+    
+    snprintf(temp_name, sizeof(temp_name), "%s.tmp", out_file_name);
+    out_file = fopen(temp_name, "wb");
+    if (out_file == NULL) {
+        printf("fopen failed for %s file\n", temp_name);
+        return -1;
+    }
+    
+    bzero(&header, sizeof(header));
+    memcpy(header.magic, delta ? TRACE_DELTA_MAGIC : TRACE_MAGIC, sizeof(header.magic));
+    header.version = TRACE_VERSION;
+    header.record_size = sizeof(trace_record_t);
+    bzero(&last, sizeof(last));
+    
+    // header is rewritten once the record count is known
+    failed = fwrite(&header, sizeof(header), 1, out_file) != 1;
+    
+    reader = iplc_sim_open_reader(trace_file, 0, 0);
+    if (reader == NULL)
+        printf("Out of memory converting to %s \n", out_file_name);
+    count = reader ? 0 : -1;
+    while (reader && !failed && (count = iplc_sim_read_batch(reader, &batch, NULL)) > 0) {
+        if (!delta)
+            failed = fwrite(batch, sizeof(trace_record_t), count, out_file) != (size_t) count;
+        for (r = 0; delta && !failed && r < count; r++) {
+            length = iplc_sim_delta_encode(&batch[r], &last, packed);
+            if (length < 0)
+                break;
+            failed = fwrite(packed, 1, length, out_file) != (size_t) length;
+        }
+        header.record_count += delta ? r : count;
+        if (delta && r < count) {
+            printf("Record %lu does not fit the delta format \n", (unsigned long) header.record_count);
+            count = -1;
+            break;
+        }
+    }
+    iplc_sim_close_reader(reader);
+    
+    // rewind() clears the error flag, so it is looked at first
+    if (count >= 0 && !failed && !ferror(out_file)) {
+        rewind(out_file);
+        failed = fwrite(&header, sizeof(header), 1, out_file) != 1;
+    }
+    else
+        failed = 1;
+    
+    if ((ferror(out_file) | fclose(out_file)) || failed || rename(temp_name, out_file_name) < 0) {
+        if (count >= 0)
+            printf("write failed for %s file\n", out_file_name);
+        unlink(temp_name);
+        return -1;
+    }
+    
+    printf("Converted %lu instructions to %s \n", (unsigned long) header.record_count, out_file_name);
+    return 0;
+}
+
+/*
+ * Load a whole trace as decoded records.  Binary trace files are mapped;
+ * any other trace, and whatever comes in on stdin for "-", is decompressed
+ * and decoded once into a private array by a reader thread.  Returns -1
+ * on error.
+ */
+int iplc_sim_load_trace(const char *file_name, trace_t *trace)
+{
+    FILE *trace_file = NULL;
+    trace_record_t *records = NULL;
+    trace_reader_t *reader = NULL;
+    const trace_record_t *batch;
+    unsigned long capacity = 0;
+    long count;
+    int mapped, stream = strcmp(file_name, "-") == 0, out_of_memory = 0;
+    
+    bzero(trace, sizeof(trace_t));
+    mapped = stream ? 0 : iplc_sim_map_trace(file_name, trace);
+    if (mapped != 0)
+        return mapped > 0 ? 0 : -1;
+    
+    trace_file = iplc_sim_open_trace(file_name);
+    if (trace_file == NULL)
+        return -1;
+    
+    reader = iplc_sim_open_reader(trace_file, 0, 0);
+    out_of_memory = reader == NULL;
+    count = reader ? 0 : -1;
+    while (reader && (count = iplc_sim_read_batch(reader, &batch, NULL)) > 0) {
+        if (trace->count + count > capacity) {
+            capacity = capacity ? capacity * 2 : 65536;
+            records = (trace_record_t *) realloc(trace->decoded, capacity * sizeof(trace_record_t));
+            if (records == NULL) {
+                out_of_memory = 1;
+                count = -1;
+                break;
+            }
+            trace->decoded = records;
+        }
+        memcpy(&trace->decoded[trace->count], batch, count * sizeof(trace_record_t));
+        trace->count += count;
+    }
+    iplc_sim_close_reader(reader);
+    fclose(trace_file);
+    
+    if (count < 0) {
+        if (out_of_memory)
+            printf("Out of memory loading %s \n", file_name);
+        iplc_sim_free_trace(trace);
+        return -1;
+    }
+    
+    trace->records = trace->decoded;
+    return 0;
+}
+
+void iplc_sim_free_trace(trace_t *trace)
+{
+    if (trace->map)
+        munmap(trace->map, trace->map_size);
+    free(trace->decoded);
+    bzero(trace, sizeof(trace_t));
+}